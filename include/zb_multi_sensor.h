@@ -8,30 +8,61 @@
 #ifndef ZB_MULTI_SENSOR_H__
 #define ZB_MULTI_SENSOR_H__
 
+#include <sys/util.h>
+
 #define ZB_HA_DEFINE_DEVICE_MULTI_SENSOR
 
+/* Clusters of disabled sensors are left out of the device, along with
+ * their attributes, simple descriptor entries and reporting slots.
+ */
 #ifdef ZB_HA_DEFINE_DEVICE_MULTI_SENSOR
 #define ZB_ZCL_SUPPORT_CLUSTER_BASIC        1
 #define ZB_ZCL_SUPPORT_CLUSTER_IDENTIFY     1
 #define ZB_ZCL_SUPPORT_CLUSTER_POWER_CONFIG 1
+#if CONFIG_SUBSYS_BME280
 #define ZB_ZCL_SUPPORT_CLUSTER_TEMP_MEASUREMENT 1
 #define ZB_ZCL_SUPPORT_CLUSTER_REL_HUMIDITY_MEASUREMENT 1
-#define ZB_ZCL_SUPPORT_CLUSTER_ILLUMINANCE_MEASUREMENT  1
 #define ZB_ZCL_SUPPORT_CLUSTER_PRESSURE_MEASUREMENT 1
+#endif
+#if CONFIG_SUBSYS_MAX44009
+#define ZB_ZCL_SUPPORT_CLUSTER_ILLUMINANCE_MEASUREMENT  1
+#endif
 #endif /* ZB_HA_DEFINE_DEVICE_MULTI_SENSOR  */
 
-#define ZB_MULTI_SENSOR_REPORT_ATTR_COUNT  6
+/* Basic, Identify and Power Configuration, plus temperature, humidity and
+ * pressure measurement of the BME280 and illuminance measurement of the
+ * MAX44009. Plain numbers, the simple descriptor type is named after them.
+ */
+#if CONFIG_SUBSYS_BME280 && CONFIG_SUBSYS_MAX44009
+#define ZB_MULTI_SENSOR_IN_CLUSTER_NUM     7
+#elif CONFIG_SUBSYS_BME280
+#define ZB_MULTI_SENSOR_IN_CLUSTER_NUM     6
+#elif CONFIG_SUBSYS_MAX44009
+#define ZB_MULTI_SENSOR_IN_CLUSTER_NUM     4
+#else
+#define ZB_MULTI_SENSOR_IN_CLUSTER_NUM     3
+#endif
+
+/* One reportable MeasuredValue per measurement cluster, plus two slots for
+ * the Power Configuration cluster.
+ */
+#define ZB_MULTI_SENSOR_REPORT_ATTR_COUNT  (ZB_MULTI_SENSOR_IN_CLUSTER_NUM - 3 + 2)
 #define ZB_DEVICE_VER_MULTI_SENSOR         0                                    /**< Multisensor device version. */
-#define ZB_MULTI_SENSOR_IN_CLUSTER_NUM     7                                    /**< Number of the input (server) clusters in the multisensor device. */
 #define ZB_MULTI_SENSOR_OUT_CLUSTER_NUM    1                                    /**< Number of the output (client) clusters in the multisensor device. */
 
 /** @brief Declares cluster list for the multisensor device.
  *
- *  @param cluster_list_name            Cluster list variable name.
- *  @param basic_attr_list              Attribute list for the Basic cluster.
- *  @param identify_attr_list           Attribute list for the Identify cluster.
- *  @param temp_measure_attr_list       Attribute list for the Temperature Measurement cluster.
- *  @param pressure_measure_attr_list   Attribute list for the Pressure Measurement cluster.
+ *  The measurement clusters of disabled sensors are left out, their
+ *  attribute lists need not exist.
+ *
+ *  @param cluster_list_name              Cluster list variable name.
+ *  @param basic_attr_list                Attribute list for the Basic cluster.
+ *  @param identify_attr_list             Attribute list for the Identify cluster.
+ *  @param temp_measure_attr_list         Attribute list for the Temperature Measurement cluster.
+ *  @param humm_measure_attr_list         Attribute list for the Relative Humidity Measurement cluster.
+ *  @param pres_measure_attr_list         Attribute list for the Pressure Measurement cluster.
+ *  @param illuminance_measure_attr_list  Attribute list for the Illuminance Measurement cluster.
+ *  @param power_measure_attr_list        Attribute list for the Power Configuration cluster.
  */
 #define ZB_DECLARE_MULTI_SENSOR_CLUSTER_LIST(                       \
       cluster_list_name,                                            \
@@ -40,6 +71,7 @@
       temp_measure_attr_list,                                       \
       humm_measure_attr_list,                                       \
       pres_measure_attr_list,                                       \
+      illuminance_measure_attr_list,                                \
       power_measure_attr_list)                                      \
       zb_zcl_cluster_desc_t cluster_list_name[] =                   \
       {                                                             \
@@ -57,6 +89,7 @@
           ZB_ZCL_CLUSTER_SERVER_ROLE,                               \
           ZB_ZCL_MANUF_CODE_INVALID                                 \
         ),                                                          \
+        COND_CODE_1(CONFIG_SUBSYS_BME280, (                         \
         ZB_ZCL_CLUSTER_DESC(                                        \
           ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,                       \
           ZB_ZCL_ARRAY_SIZE(temp_measure_attr_list, zb_zcl_attr_t), \
@@ -77,7 +110,7 @@
           (pres_measure_attr_list),                                 \
           ZB_ZCL_CLUSTER_SERVER_ROLE,                               \
           ZB_ZCL_MANUF_CODE_INVALID                                 \
-        ),                                                          \
+        ),), ())                                                    \
         ZB_ZCL_CLUSTER_DESC(                                        \
           ZB_ZCL_CLUSTER_ID_POWER_CONFIG,                           \
           ZB_ZCL_ARRAY_SIZE(power_measure_attr_list, zb_zcl_attr_t),\
@@ -85,13 +118,14 @@
           ZB_ZCL_CLUSTER_SERVER_ROLE,                               \
           ZB_ZCL_MANUF_CODE_INVALID                                 \
         ),                                                          \
+        COND_CODE_1(CONFIG_SUBSYS_MAX44009, (                       \
         ZB_ZCL_CLUSTER_DESC(                                        \
           ZB_ZCL_CLUSTER_ID_ILLUMINANCE_MEASUREMENT,                \
           ZB_ZCL_ARRAY_SIZE(illuminance_measure_attr_list, zb_zcl_attr_t),\
-          (illuminance_measure_attr_list),                                \
+          (illuminance_measure_attr_list),                          \
           ZB_ZCL_CLUSTER_SERVER_ROLE,                               \
           ZB_ZCL_MANUF_CODE_INVALID                                 \
-        ),                                                          \
+        ),), ())                                                    \
         ZB_ZCL_CLUSTER_DESC(                                        \
           ZB_ZCL_CLUSTER_ID_IDENTIFY,                               \
           0,                                                        \
@@ -122,10 +156,12 @@
     {                                                                                 \
       ZB_ZCL_CLUSTER_ID_BASIC,                                                        \
       ZB_ZCL_CLUSTER_ID_IDENTIFY,                                                     \
+      COND_CODE_1(CONFIG_SUBSYS_BME280, (                                             \
       ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,                                             \
       ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,                                     \
-      ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT,                                         \
-      ZB_ZCL_CLUSTER_ID_ILLUMINANCE_MEASUREMENT,                                      \
+      ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT,), ())                                   \
+      COND_CODE_1(CONFIG_SUBSYS_MAX44009, (                                           \
+      ZB_ZCL_CLUSTER_ID_ILLUMINANCE_MEASUREMENT,), ())                                \
       ZB_ZCL_CLUSTER_ID_POWER_CONFIG,                                                 \
       ZB_ZCL_CLUSTER_ID_IDENTIFY,                                                     \
     }                                                                                 \
@@ -142,7 +178,7 @@
       ep_id,                                                                      \
       ZB_MULTI_SENSOR_IN_CLUSTER_NUM,                                             \
       ZB_MULTI_SENSOR_OUT_CLUSTER_NUM);                                           \
-  ZBOSS_DEVICE_DECLARE_REPORTING_CTX(reporting_info## device_ctx_name,            \
+  ZBOSS_DEVICE_DECLARE_REPORTING_CTX(reporting_info_##ep_name,                   \
                                      ZB_MULTI_SENSOR_REPORT_ATTR_COUNT);          \
   ZB_AF_DECLARE_ENDPOINT_DESC(ep_name, ep_id,                                     \
       ZB_AF_HA_PROFILE_ID,                                                        \
@@ -151,7 +187,7 @@
       ZB_ZCL_ARRAY_SIZE(cluster_list, zb_zcl_cluster_desc_t),                     \
       cluster_list,                                                               \
       (zb_af_simple_desc_1_1_t*)&simple_desc_##ep_name,                           \
-      ZB_MULTI_SENSOR_REPORT_ATTR_COUNT, reporting_info## device_ctx_name, 0, NULL)
+      ZB_MULTI_SENSOR_REPORT_ATTR_COUNT, reporting_info_##ep_name, 0, NULL)
 
 
 
@@ -6,15 +6,19 @@
 
 #define DT_DRV_COMPAT gooddisplay_uc8151
 
+#include <stddef.h>
 #include <string.h>
 #include <device.h>
 #include <init.h>
 #include <drivers/display.h>
 #include <drivers/gpio.h>
 #include <drivers/spi.h>
+#include <pm/device.h>
+#include <sys/atomic.h>
 #include <sys/byteorder.h>
 
 #include "display_uc8151.h"
+#include "uc8151.h"
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(uc8151, CONFIG_DISPLAY_LOG_LEVEL);
@@ -28,7 +32,7 @@ LOG_MODULE_REGISTER(uc8151, CONFIG_DISPLAY_LOG_LEVEL);
 
 #define UC8151_DC_PIN DT_INST_GPIO_PIN(0, dc_gpios)
 #define UC8151_DC_FLAGS DT_INST_GPIO_FLAGS(0, dc_gpios)
-#define UC8151_DC_CNTRL DT_INST_GPIO_LABEL(0, dc_gpios))
+#define UC8151_DC_CNTRL DT_INST_GPIO_LABEL(0, dc_gpios)
 #define UC8151_BUSY_PIN DT_INST_GPIO_PIN(0, busy_gpios)
 #define UC8151_BUSY_CNTRL DT_INST_GPIO_LABEL(0, busy_gpios)
 #define UC8151_BUSY_FLAGS DT_INST_GPIO_FLAGS(0, busy_gpios)
@@ -43,6 +47,41 @@ LOG_MODULE_REGISTER(uc8151, CONFIG_DISPLAY_LOG_LEVEL);
 /* Horizontally aligned page! */
 #define UC8151_NUMOF_PAGES		(EPD_PANEL_WIDTH / \
 					 UC8151_PIXELS_PER_BYTE)
+#define UC8151_FB_SIZE			(UC8151_NUMOF_PAGES * \
+					 EPD_PANEL_HEIGHT)
+#define UC8151_NUMOF_WORDS		(UC8151_NUMOF_PAGES / \
+					 sizeof(uint32_t))
+
+/* Maximum number of SPI buffers recorded in one command batch */
+#define UC8151_BATCH_MAX_BUFS		24U
+
+/* Constant pattern chunk streamed when filling the whole frame */
+#define UC8151_FILL_CHUNK_SIZE		64U
+
+#if defined(CONFIG_UC8151_POWER_AFTER_REFRESH_DEEP_SLEEP)
+#define UC8151_POWER_AFTER_REFRESH	UC8151_POWER_DEEP_SLEEP
+#elif defined(CONFIG_UC8151_POWER_AFTER_REFRESH_OFF)
+#define UC8151_POWER_AFTER_REFRESH	UC8151_POWER_OFF
+#else
+#define UC8151_POWER_AFTER_REFRESH	UC8151_POWER_ACTIVE
+#endif
+
+#ifdef CONFIG_UC8151_STATS
+#define UC8151_STATS_ADD(driver, field, n) ((driver)->stats.field += (n))
+#else
+#define UC8151_STATS_ADD(driver, field, n)
+#endif
+
+/* Rotated writes are converted in groups of 8 panel rows */
+#define UC8151_ROTATE_GROUP_ROWS	8U
+
+/* Partial window, all coordinates inclusive and x byte aligned */
+struct uc8151_rect {
+	uint16_t x_start;
+	uint16_t y_start;
+	uint16_t x_end;
+	uint16_t y_end;
+};
 
 struct uc8151_data {
 	const struct uc8151_config *config;
@@ -50,169 +89,1431 @@ struct uc8151_data {
 	const struct device *dc;
 	const struct device *busy;
 	const struct device *cs;
+	/* Orientation of the coordinates passed to write */
+	enum display_orientation orientation;
+	enum uc8151_power_state power;
+	/* State entered once the running refresh completes */
+	enum uc8151_power_state power_next;
+	bool refresh_pending;
+	/* A refresh after a wake up is due to complete the latency */
+	bool wake_pending;
+	uint32_t power_since;
+	uint32_t refresh_start;
+	uint32_t wake_start;
+	struct uc8151_power_stats power_stats;
+#ifdef CONFIG_UC8151_STATS
+	struct uc8151_stats stats;
+	/* DC level of the last transfer */
+	bool dc_cmd;
+#endif
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+	uint8_t fb[UC8151_FB_SIZE] __aligned(4);
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+	/* Frame currently shown on the panel */
+	uint8_t prev[UC8151_FB_SIZE] __aligned(4);
+#endif
+	struct uc8151_rect dirty[CONFIG_UC8151_DIRTY_RECTS_MAX];
+	uint8_t num_dirty;
+#endif
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+	struct gpio_callback busy_cb;
+	struct k_sem busy_sem;
+	/* Uptime of the last BUSY release seen by the interrupt */
+	uint32_t busy_release;
+	/* Asynchronous refresh in progress */
+	atomic_t async_busy;
+	/* Next BUSY release continues the asynchronous refresh */
+	atomic_t async_armed;
+	struct k_work refresh_work;
+	uc8151_refresh_cb_t refresh_cb;
+	void *refresh_user_data;
+#endif
 };
 
 struct uc8151_config {
 	struct spi_dt_spec bus;
 };
 
-static uint8_t uc8151_softstart[] = DT_INST_PROP(0, softstart);
-static uint8_t uc8151_pwr[] = DT_INST_PROP(0, pwr);
+/*
+ * Sequence of commands and payloads sent in one locked SPI session with
+ * CS held. Consecutive buffers with the same DC level go out as one
+ * scatter-gather transfer. Payloads must stay valid until the batch ends.
+ */
+struct uc8151_batch {
+	struct spi_config spi_cfg;
+	struct spi_buf bufs[UC8151_BATCH_MAX_BUFS];
+	/* Opcode storage, indexed like bufs */
+	uint8_t opcodes[UC8151_BATCH_MAX_BUFS];
+	/* Bit n set if bufs[n] is an opcode */
+	uint32_t cmd_mask;
+	uint8_t count;
+	int err;
+};
+
+static uint8_t uc8151_softstart[] = DT_INST_PROP(0, softstart);
+static uint8_t uc8151_pwr[] = DT_INST_PROP(0, pwr);
+
+/* Border and data polarity settings */
+static uint8_t bdd_polarity;
+
+static bool blanking_on = true;
+
+static void uc8151_batch_init(struct uc8151_data *driver,
+			      struct uc8151_batch *batch)
+{
+	batch->spi_cfg = driver->config->bus.config;
+	batch->spi_cfg.operation |= SPI_LOCK_ON | SPI_HOLD_ON_CS;
+	batch->cmd_mask = 0U;
+	batch->count = 0U;
+	batch->err = 0;
+}
+
+/* Send the recorded buffers, switching DC only between segments */
+static int uc8151_batch_send(struct uc8151_data *driver,
+			     struct uc8151_batch *batch)
+{
+	struct spi_buf_set buf_set;
+	uint8_t start = 0U;
+	uint8_t end;
+	bool cmd;
+
+	while (start < batch->count) {
+		cmd = (batch->cmd_mask & BIT(start)) != 0U;
+		for (end = start + 1U; end < batch->count; end++) {
+			if (((batch->cmd_mask & BIT(end)) != 0U) != cmd) {
+				break;
+			}
+		}
+
+		gpio_pin_set(driver->dc, UC8151_DC_PIN, cmd ? 1 : 0);
+		buf_set.buffers = &batch->bufs[start];
+		buf_set.count = end - start;
+		if (spi_write(driver->config->bus.bus, &batch->spi_cfg,
+			      &buf_set)) {
+			return -EIO;
+		}
+
+#ifdef CONFIG_UC8151_STATS
+		driver->stats.transfers++;
+		driver->stats.dc_toggles += driver->dc_cmd != cmd;
+		driver->dc_cmd = cmd;
+		for (uint8_t i = start; i < end; i++) {
+			if (cmd) {
+				driver->stats.commands++;
+			} else {
+				driver->stats.payload_bytes +=
+					batch->bufs[i].len;
+			}
+		}
+#endif
+
+		start = end;
+	}
+
+	batch->cmd_mask = 0U;
+	batch->count = 0U;
+
+	return 0;
+}
+
+/* Reserve a buffer slot, sending what is recorded if the batch is full */
+static int uc8151_batch_slot(struct uc8151_data *driver,
+			     struct uc8151_batch *batch)
+{
+	if (batch->err) {
+		return -1;
+	}
+
+	if (batch->count == ARRAY_SIZE(batch->bufs)) {
+		batch->err = uc8151_batch_send(driver, batch);
+		if (batch->err) {
+			return -1;
+		}
+	}
+
+	return batch->count++;
+}
+
+static void uc8151_batch_data(struct uc8151_data *driver,
+			      struct uc8151_batch *batch,
+			      const uint8_t *data, size_t len)
+{
+	int slot = uc8151_batch_slot(driver, batch);
+
+	if (slot < 0) {
+		return;
+	}
+
+	batch->bufs[slot].buf = (uint8_t *)data;
+	batch->bufs[slot].len = len;
+}
+
+static void uc8151_batch_cmd(struct uc8151_data *driver,
+			     struct uc8151_batch *batch, uint8_t cmd,
+			     const uint8_t *data, size_t len)
+{
+	int slot = uc8151_batch_slot(driver, batch);
+
+	if (slot < 0) {
+		return;
+	}
+
+	batch->opcodes[slot] = cmd;
+	batch->bufs[slot].buf = &batch->opcodes[slot];
+	batch->bufs[slot].len = sizeof(cmd);
+	batch->cmd_mask |= BIT(slot);
+
+	if (data != NULL) {
+		uc8151_batch_data(driver, batch, data, len);
+	}
+}
+
+/* Send what is recorded so far, keeping the SPI session open */
+static void uc8151_batch_flush(struct uc8151_data *driver,
+			       struct uc8151_batch *batch)
+{
+	if (!batch->err) {
+		batch->err = uc8151_batch_send(driver, batch);
+	}
+}
+
+/* Send the rest of the batch and end the SPI session */
+static int uc8151_batch_end(struct uc8151_data *driver,
+			    struct uc8151_batch *batch)
+{
+	if (!batch->err) {
+		batch->err = uc8151_batch_send(driver, batch);
+	}
+
+	spi_release(driver->config->bus.bus, &batch->spi_cfg);
+
+	return batch->err ? -EIO : 0;
+}
+
+static inline int uc8151_write_cmd(struct uc8151_data *driver,
+				   uint8_t cmd, uint8_t *data, size_t len)
+{
+	struct uc8151_batch batch;
+
+	uc8151_batch_init(driver, &batch);
+	uc8151_batch_cmd(driver, &batch, cmd, data, len);
+
+	return uc8151_batch_end(driver, &batch);
+}
+
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+/*
+ * Level interrupts are served by the GPIO sense mechanism and do not keep
+ * a GPIOTE channel running, so the interrupt is armed only while waiting
+ * and disarmed again from the handler.
+ */
+static void uc8151_busy_handler(const struct device *port,
+				struct gpio_callback *cb,
+				gpio_port_pins_t pins)
+{
+	struct uc8151_data *driver =
+		CONTAINER_OF(cb, struct uc8151_data, busy_cb);
+
+	gpio_pin_interrupt_configure(port, UC8151_BUSY_PIN, GPIO_INT_DISABLE);
+	driver->busy_release = k_uptime_get_32();
+
+	if (atomic_cas(&driver->async_armed, 1, 0)) {
+		k_work_submit(&driver->refresh_work);
+	} else {
+		k_sem_give(&driver->busy_sem);
+	}
+}
+
+static inline int uc8151_busy_arm(struct uc8151_data *driver)
+{
+	return gpio_pin_interrupt_configure(driver->busy, UC8151_BUSY_PIN,
+					    GPIO_INT_LEVEL_INACTIVE);
+}
+
+static inline int uc8151_busy_wait_pin(struct uc8151_data *driver)
+{
+	if (gpio_pin_get(driver->busy, UC8151_BUSY_PIN) <= 0) {
+		return 0;
+	}
+
+	k_sem_reset(&driver->busy_sem);
+	if (uc8151_busy_arm(driver)) {
+		return -EIO;
+	}
+
+	if (k_sem_take(&driver->busy_sem,
+		       K_MSEC(CONFIG_UC8151_BUSY_TIMEOUT_MS))) {
+		gpio_pin_interrupt_configure(driver->busy, UC8151_BUSY_PIN,
+					     GPIO_INT_DISABLE);
+		LOG_ERR("BUSY timeout");
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+#else
+static inline int uc8151_busy_wait_pin(struct uc8151_data *driver)
+{
+	int pin = gpio_pin_get(driver->busy, UC8151_BUSY_PIN);
+
+	while (pin > 0) {
+		__ASSERT(pin >= 0, "Failed to get pin level");
+		LOG_DBG("wait %u", pin);
+		k_sleep(K_MSEC(UC8151_BUSY_DELAY));
+		pin = gpio_pin_get(driver->busy, UC8151_BUSY_PIN);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_UC8151_BUSY_INTERRUPT */
+
+static void uc8151_power_set(struct uc8151_data *driver,
+			     enum uc8151_power_state state, uint32_t now)
+{
+	driver->power_stats.time_ms[driver->power] += now - driver->power_since;
+	driver->power_since = now;
+	driver->power = state;
+}
+
+/* Account the end of a pending refresh, BUSY must be released */
+static void uc8151_refresh_done(struct uc8151_data *driver)
+{
+	struct uc8151_power_stats *stats = &driver->power_stats;
+	uint32_t done = k_uptime_get_32();
+
+	if (!driver->refresh_pending) {
+		return;
+	}
+
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+	/* The interrupt saw the release earlier than we do */
+	if ((int32_t)(driver->busy_release - driver->refresh_start) >= 0) {
+		done = driver->busy_release;
+	}
+#endif
+
+	driver->refresh_pending = false;
+	uc8151_power_set(driver, driver->power_next, done);
+	UC8151_STATS_ADD(driver, refresh_ms, done - driver->refresh_start);
+
+	if (driver->wake_pending) {
+		driver->wake_pending = false;
+		stats->last_wake_to_pixels_ms = done - driver->wake_start;
+		stats->max_wake_to_pixels_ms =
+			MAX(stats->max_wake_to_pixels_ms,
+			    stats->last_wake_to_pixels_ms);
+	}
+}
+
+static int uc8151_busy_wait(struct uc8151_data *driver)
+{
+	int err;
+#ifdef CONFIG_UC8151_STATS
+	uint32_t start = k_uptime_get_32();
+
+	if (gpio_pin_get(driver->busy, UC8151_BUSY_PIN) > 0) {
+		driver->stats.busy_waits++;
+	}
+#endif
+
+	err = uc8151_busy_wait_pin(driver);
+
+	UC8151_STATS_ADD(driver, busy_wait_ms, k_uptime_get_32() - start);
+	if (err) {
+		return err;
+	}
+
+	uc8151_refresh_done(driver);
+
+	return 0;
+}
+
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+#define UC8151_CHECK_ASYNC_IDLE(driver)					\
+	do {								\
+		if (atomic_get(&(driver)->async_busy)) {		\
+			return -EBUSY;					\
+		}							\
+	} while (0)
+#else
+#define UC8151_CHECK_ASYNC_IDLE(driver) ARG_UNUSED(driver)
+#endif
+
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+static int uc8151_flush_all(const struct device *dev);
+#endif
+
+/* Reset the controller and program the panel registers, powered off */
+static int uc8151_controller_setup(const struct device *dev)
+{
+	struct uc8151_data *driver = dev->data;
+	struct uc8151_batch batch;
+	uint8_t tres[UC8151_TRES_REG_LENGTH];
+	uint8_t cdi[UC8151_CDI_REG_LENGTH];
+	uint8_t psr;
+	uint8_t tcon;
+
+	gpio_pin_set(driver->reset, UC8151_RESET_PIN, 1);
+	k_sleep(K_MSEC(UC8151_RESET_DELAY));
+	gpio_pin_set(driver->reset, UC8151_RESET_PIN, 0);
+	k_sleep(K_MSEC(UC8151_RESET_DELAY));
+
+	if (uc8151_busy_wait(driver)) {
+		return -EIO;
+	}
+
+	LOG_DBG("Initialize UC8151 controller");
+
+	/* Pannel settings, KW mode */
+	psr = UC8151_PSR_KW_R |
+	      UC8151_PSR_UD |
+	      UC8151_PSR_SHL |
+	      UC8151_PSR_SHD |
+	      UC8151_PSR_RST;
+
+	/* Set panel resolution */
+	sys_put_be16(EPD_PANEL_WIDTH, &tres[UC8151_TRES_HRES_IDX]);
+	sys_put_be16(EPD_PANEL_HEIGHT, &tres[UC8151_TRES_VRES_IDX]);
+	LOG_HEXDUMP_DBG(tres, sizeof(tres), "TRES");
+
+	bdd_polarity = UC8151_CDI_BDV1 |
+		       UC8151_CDI_N2OCP | UC8151_CDI_DDX0;
+	cdi[UC8151_CDI_BDZ_DDX_IDX] = bdd_polarity;
+	cdi[UC8151_CDI_CDI_IDX] = DT_INST_PROP(0, cdi);
+	LOG_HEXDUMP_DBG(cdi, sizeof(cdi), "CDI");
+
+	tcon = DT_INST_PROP(0, tcon);
+
+	/* Booster, regulators and panel settings, applied on power on */
+	uc8151_batch_init(driver, &batch);
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_PWR,
+			 uc8151_pwr, sizeof(uc8151_pwr));
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_BTST,
+			 uc8151_softstart, sizeof(uc8151_softstart));
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_PSR, &psr, sizeof(psr));
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_TRES, tres, sizeof(tres));
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_CDI, cdi, sizeof(cdi));
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_TCON, &tcon, sizeof(tcon));
+	if (uc8151_batch_end(driver, &batch)) {
+		return -EIO;
+	}
+
+	uc8151_power_set(driver, UC8151_POWER_OFF, k_uptime_get_32());
+	UC8151_STATS_ADD(driver, resets, 1);
+
+	return 0;
+}
+
+/* Turn on: booster, controller, regulators, and sensor. */
+static int uc8151_power_on(struct uc8151_data *driver)
+{
+	if (uc8151_write_cmd(driver, UC8151_CMD_PON, NULL, 0)) {
+		return -EIO;
+	}
+
+	k_sleep(K_MSEC(UC8151_PON_DELAY));
+	if (uc8151_busy_wait(driver)) {
+		return -EIO;
+	}
+
+	uc8151_power_set(driver, UC8151_POWER_ACTIVE, k_uptime_get_32());
+
+	return 0;
+}
+
+/*
+ * Wait for a running refresh and bring the controller out of deep sleep.
+ * Deep sleep does not retain the frame memory, it is reloaded from the
+ * shadow framebuffer instead of clearing the panel.
+ */
+static int uc8151_wake(const struct device *dev)
+{
+	struct uc8151_data *driver = dev->data;
+	uint32_t start;
+
+	if (uc8151_busy_wait(driver)) {
+		return -EIO;
+	}
+
+	if (driver->power != UC8151_POWER_DEEP_SLEEP) {
+		return 0;
+	}
+
+	start = k_uptime_get_32();
+	if (uc8151_controller_setup(dev)) {
+		return -EIO;
+	}
+
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+	struct uc8151_batch batch;
+
+	uc8151_batch_init(driver, &batch);
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM1,
+			 driver->prev, sizeof(driver->prev));
+#endif
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM2,
+			 driver->fb, sizeof(driver->fb));
+	if (uc8151_batch_end(driver, &batch)) {
+		return -EIO;
+	}
+#endif
+
+	driver->wake_start = start;
+	driver->wake_pending = true;
+	driver->power_stats.wakeups++;
+	driver->power_stats.last_wake_ms = k_uptime_get_32() - start;
+	LOG_DBG("Woken up in %u ms", driver->power_stats.last_wake_ms);
+
+	return 0;
+}
+
+/* True if the last refresh sends the controller to deep sleep */
+static inline bool uc8151_sleep_pending(struct uc8151_data *driver)
+{
+	return driver->refresh_pending &&
+	       driver->power_next == UC8151_POWER_DEEP_SLEEP;
+}
+
+static int uc8151_update_display(const struct device *dev)
+{
+	struct uc8151_data *driver = dev->data;
+	enum uc8151_power_state next = UC8151_POWER_AFTER_REFRESH;
+	uint8_t auto_seq = UC8151_AUTO_PON_DRF_POF;
+	int err;
+
+	if (uc8151_wake(dev)) {
+		return -EIO;
+	}
+
+	LOG_DBG("Trigger update sequence");
+	if (next == UC8151_POWER_ACTIVE) {
+		if (driver->power != UC8151_POWER_ACTIVE &&
+		    uc8151_power_on(driver)) {
+			return -EIO;
+		}
+
+		err = uc8151_write_cmd(driver, UC8151_CMD_DRF, NULL, 0);
+	} else {
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+		/* Stay awake while more windows are queued for refresh */
+		if (driver->num_dirty > 0) {
+			next = UC8151_POWER_OFF;
+		}
+#endif
+		if (next == UC8151_POWER_DEEP_SLEEP) {
+			auto_seq = UC8151_AUTO_PON_DRF_POF_DSLP;
+		}
+
+		err = uc8151_write_cmd(driver, UC8151_CMD_AUTO,
+				       &auto_seq, sizeof(auto_seq));
+	}
+
+	if (err) {
+		return -EIO;
+	}
+
+	UC8151_STATS_ADD(driver, refreshes, 1);
+	driver->refresh_start = k_uptime_get_32();
+	driver->refresh_pending = true;
+	driver->power_next = next;
+	uc8151_power_set(driver, UC8151_POWER_ACTIVE, driver->refresh_start);
+
+	k_sleep(K_MSEC(UC8151_BUSY_DELAY));
+
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+	/* Catch the end of the refresh for the power statistics */
+	uc8151_busy_arm(driver);
+#endif
+
+	return 0;
+}
+
+static int uc8151_blanking_off(const struct device *dev)
+{
+	struct uc8151_data *driver = dev->data;
+
+	UC8151_CHECK_ASYNC_IDLE(driver);
+
+	if (blanking_on) {
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+		/* Load pending windows, refreshed below all at once */
+		if (uc8151_flush_all(dev)) {
+			return -EIO;
+		}
+#endif
+		/* Update EPD pannel in normal mode */
+		if (uc8151_busy_wait(driver)) {
+			return -EIO;
+		}
+
+		if (uc8151_update_display(dev)) {
+			return -EIO;
+		}
+	}
+
+	blanking_on = false;
+
+	return 0;
+}
+
+static int uc8151_blanking_on(const struct device *dev)
+{
+	blanking_on = true;
+
+	return 0;
+}
+
+static void uc8151_batch_rows(struct uc8151_data *driver,
+			      struct uc8151_batch *batch,
+			      const uint8_t *src, size_t row_len,
+			      size_t pitch, uint16_t rows)
+{
+	/* Contiguous rows go out as a single buffer */
+	if (pitch == row_len) {
+		uc8151_batch_data(driver, batch, src, row_len * rows);
+		return;
+	}
+
+	for (uint16_t i = 0; i < rows; i++) {
+		uc8151_batch_data(driver, batch, src, row_len);
+		src += pitch;
+	}
+}
+
+/* Partial window registers, must stay valid until the batch is sent */
+struct uc8151_window_regs {
+	uint8_t ptl[UC8151_PTL_REG_LENGTH];
+	uint8_t cdi_bdz;
+};
+
+/* Wait for the controller and start a batch entering partial mode */
+static int uc8151_window_begin(const struct device *dev,
+			       struct uc8151_batch *batch,
+			       const struct uc8151_rect *win,
+			       struct uc8151_window_regs *regs)
+{
+	struct uc8151_data *driver = dev->data;
+
+	/* Setup Partial Window and enable Partial Mode */
+	memset(regs->ptl, 0, sizeof(regs->ptl));
+	sys_put_be16(win->x_start, &regs->ptl[UC8151_PTL_HRST_IDX]);
+	sys_put_be16(win->x_end, &regs->ptl[UC8151_PTL_HRED_IDX]);
+	sys_put_be16(win->y_start, &regs->ptl[UC8151_PTL_VRST_IDX]);
+	sys_put_be16(win->y_end, &regs->ptl[UC8151_PTL_VRED_IDX]);
+	regs->ptl[sizeof(regs->ptl) - 1] = UC8151_PTL_PT_SCAN;
+	regs->cdi_bdz = bdd_polarity | UC8151_CDI_BDZ;
+	LOG_HEXDUMP_DBG(regs->ptl, sizeof(regs->ptl), "ptl");
+
+	if (uc8151_wake(dev)) {
+		return -EIO;
+	}
+
+	uc8151_batch_init(driver, batch);
+	uc8151_batch_cmd(driver, batch, UC8151_CMD_PTIN, NULL, 0);
+	uc8151_batch_cmd(driver, batch, UC8151_CMD_PTL,
+			 regs->ptl, sizeof(regs->ptl));
+	/* Disable boarder output */
+	uc8151_batch_cmd(driver, batch, UC8151_CMD_CDI,
+			 &regs->cdi_bdz, sizeof(regs->cdi_bdz));
+
+	return 0;
+}
+
+/* End the window batch, refresh the window and leave partial mode */
+static int uc8151_window_end(const struct device *dev,
+			     struct uc8151_batch *batch)
+{
+	struct uc8151_data *driver = dev->data;
+
+	if (uc8151_batch_end(driver, batch)) {
+		return -EIO;
+	}
+
+	/* Update partial window */
+	if (blanking_on == false) {
+		if (uc8151_update_display(dev)) {
+			return -EIO;
+		}
+	}
+
+	/* Partial mode is left by the reset on wake up */
+	if (uc8151_sleep_pending(driver)) {
+		return 0;
+	}
+
+	/* Enable boarder output and disable Partial Mode */
+	uc8151_batch_init(driver, batch);
+	uc8151_batch_cmd(driver, batch, UC8151_CMD_CDI,
+			 &bdd_polarity, sizeof(bdd_polarity));
+	uc8151_batch_cmd(driver, batch, UC8151_CMD_PTOUT, NULL, 0);
+
+	return uc8151_batch_end(driver, batch);
+}
+
+/*
+ * Push one partial window to the controller. Rows of the window are read
+ * from src, pitch bytes apart. If old is not NULL, the rows at the same
+ * offsets in old are sent as the previous frame through DTM1.
+ */
+static int uc8151_write_window(const struct device *dev,
+			       const struct uc8151_rect *win,
+			       const uint8_t *src, const uint8_t *old,
+			       size_t pitch)
+{
+	struct uc8151_data *driver = dev->data;
+	size_t row_len = (win->x_end - win->x_start + 1U) /
+			 UC8151_PIXELS_PER_BYTE;
+	uint16_t rows = win->y_end - win->y_start + 1U;
+	struct uc8151_window_regs regs;
+	struct uc8151_batch batch;
+
+	if (uc8151_window_begin(dev, &batch, win, &regs)) {
+		return -EIO;
+	}
+
+	if (old != NULL) {
+		uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM1, NULL, 0);
+		uc8151_batch_rows(driver, &batch, old, row_len, pitch, rows);
+	}
+
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM2, NULL, 0);
+	uc8151_batch_rows(driver, &batch, src, row_len, pitch, rows);
+
+	return uc8151_window_end(dev, &batch);
+}
+
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+/*
+ * Cost of pushing a window, in bytes of pixel data. Every window is
+ * charged a fixed amount for its command sequence and partial refresh.
+ */
+static uint32_t uc8151_rect_cost(const struct uc8151_rect *rect)
+{
+	return ((rect->x_end - rect->x_start + 1U) / UC8151_PIXELS_PER_BYTE) *
+	       (rect->y_end - rect->y_start + 1U) +
+	       CONFIG_UC8151_WINDOW_COST_BYTES;
+}
+
+static void uc8151_rect_union(struct uc8151_rect *dst,
+			      const struct uc8151_rect *a,
+			      const struct uc8151_rect *b)
+{
+	dst->x_start = MIN(a->x_start, b->x_start);
+	dst->y_start = MIN(a->y_start, b->y_start);
+	dst->x_end = MAX(a->x_end, b->x_end);
+	dst->y_end = MAX(a->y_end, b->y_end);
+}
+
+/* Merge dirty rectangles as long as the merged window is cheaper */
+static void uc8151_coalesce_dirty(struct uc8151_data *driver)
+{
+	struct uc8151_rect merged;
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+		for (int i = 0; i < driver->num_dirty && !changed; i++) {
+			for (int j = i + 1; j < driver->num_dirty; j++) {
+				uc8151_rect_union(&merged, &driver->dirty[i],
+						  &driver->dirty[j]);
+				if (uc8151_rect_cost(&merged) >
+				    uc8151_rect_cost(&driver->dirty[i]) +
+				    uc8151_rect_cost(&driver->dirty[j])) {
+					continue;
+				}
+
+				driver->dirty[i] = merged;
+				driver->num_dirty--;
+				driver->dirty[j] =
+					driver->dirty[driver->num_dirty];
+				changed = true;
+				break;
+			}
+		}
+	}
+}
+
+static void uc8151_mark_dirty(struct uc8151_data *driver,
+			      const struct uc8151_rect *rect)
+{
+	struct uc8151_rect merged;
+	uint32_t growth;
+	uint32_t best_growth = UINT32_MAX;
+	int best = 0;
+
+	if (driver->num_dirty < ARRAY_SIZE(driver->dirty)) {
+		driver->dirty[driver->num_dirty++] = *rect;
+		uc8151_coalesce_dirty(driver);
+		return;
+	}
+
+	/* Out of slots, grow the rectangle that gets the least bigger */
+	for (int i = 0; i < driver->num_dirty; i++) {
+		uc8151_rect_union(&merged, &driver->dirty[i], rect);
+		growth = uc8151_rect_cost(&merged) -
+			 uc8151_rect_cost(&driver->dirty[i]);
+		if (growth < best_growth) {
+			best_growth = growth;
+			best = i;
+		}
+	}
+
+	uc8151_rect_union(&driver->dirty[best], &driver->dirty[best], rect);
+	uc8151_coalesce_dirty(driver);
+}
+
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+BUILD_ASSERT((UC8151_NUMOF_PAGES % sizeof(uint32_t)) == 0,
+	     "Panel rows must be a multiple of 32 pixels");
+
+/* Mask of the bytes first..last of a frame word */
+static inline uint32_t uc8151_byte_mask(uint8_t first, uint8_t last)
+{
+#ifdef CONFIG_BIG_ENDIAN
+	return (UINT32_MAX >> (8U * first)) & (UINT32_MAX << (8U * (3U - last)));
+#else
+	return (UINT32_MAX << (8U * first)) & (UINT32_MAX >> (8U * (3U - last)));
+#endif
+}
+
+static inline uint8_t uc8151_first_byte(uint32_t diff)
+{
+#ifdef CONFIG_BIG_ENDIAN
+	return __builtin_clz(diff) / 8U;
+#else
+	return __builtin_ctz(diff) / 8U;
+#endif
+}
+
+static inline uint8_t uc8151_last_byte(uint32_t diff)
+{
+#ifdef CONFIG_BIG_ENDIAN
+	return (31U - __builtin_ctz(diff)) / 8U;
+#else
+	return (31U - __builtin_clz(diff)) / 8U;
+#endif
+}
+
+/*
+ * Shrink rect to the bounding box of the bytes that differ between the
+ * shadow and the displayed frame, comparing a word at a time. Returns
+ * false if nothing in rect changed.
+ */
+static bool uc8151_changed_box(struct uc8151_data *driver,
+			       struct uc8151_rect *rect)
+{
+	const uint32_t *fb = (const uint32_t *)driver->fb;
+	const uint32_t *prev = (const uint32_t *)driver->prev;
+	uint16_t first_byte = rect->x_start / UC8151_PIXELS_PER_BYTE;
+	uint16_t last_byte = rect->x_end / UC8151_PIXELS_PER_BYTE;
+	uint16_t first_word = first_byte / sizeof(uint32_t);
+	uint16_t last_word = last_byte / sizeof(uint32_t);
+	uint32_t head = uc8151_byte_mask(first_byte % sizeof(uint32_t), 3U);
+	uint32_t tail = uc8151_byte_mask(0U, last_byte % sizeof(uint32_t));
+	uint16_t min_byte = UINT16_MAX;
+	uint16_t max_byte = 0U;
+	uint16_t min_row = UINT16_MAX;
+	uint16_t max_row = 0U;
+	size_t row;
+	uint32_t diff;
+
+	for (uint16_t y = rect->y_start; y <= rect->y_end; y++) {
+		row = y * UC8151_NUMOF_WORDS;
+		for (uint16_t w = first_word; w <= last_word; w++) {
+			diff = fb[row + w] ^ prev[row + w];
+			if (w == first_word) {
+				diff &= head;
+			}
+
+			if (w == last_word) {
+				diff &= tail;
+			}
+
+			if (diff == 0U) {
+				continue;
+			}
+
+			min_byte = MIN(min_byte, w * sizeof(uint32_t) +
+					       uc8151_first_byte(diff));
+			max_byte = MAX(max_byte, w * sizeof(uint32_t) +
+					       uc8151_last_byte(diff));
+			min_row = MIN(min_row, y);
+			max_row = y;
+		}
+	}
 
-/* Border and data polarity settings */
-static uint8_t bdd_polarity;
+	if (min_row == UINT16_MAX) {
+		return false;
+	}
 
-static bool blanking_on = true;
+	rect->x_start = min_byte * UC8151_PIXELS_PER_BYTE;
+	rect->x_end = max_byte * UC8151_PIXELS_PER_BYTE +
+		      UC8151_PIXELS_PER_BYTE - 1U;
+	rect->y_start = min_row;
+	rect->y_end = max_row;
 
-static inline int uc8151_write_cmd(struct uc8151_data *driver,
-				   uint8_t cmd, uint8_t *data, size_t len)
+	return true;
+}
+#endif /* CONFIG_UC8151_DIFFERENTIAL_REFRESH */
+
+/*
+ * Push the last dirty window, refreshing it unless blanking is on.
+ * Returns 0 if the window turned out to be unchanged and was dropped.
+ */
+static int uc8151_flush_window(const struct device *dev)
 {
-	struct spi_buf buf = {.buf = &cmd, .len = sizeof(cmd)};
-	struct spi_buf_set buf_set = {.buffers = &buf, .count = 1};
+	struct uc8151_data *driver = dev->data;
+	struct uc8151_rect rect = driver->dirty[--driver->num_dirty];
+	size_t offset;
+
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+	if (!uc8151_changed_box(driver, &rect)) {
+		return 0;
+	}
+#endif
+
+	offset = rect.y_start * UC8151_NUMOF_PAGES +
+		 rect.x_start / UC8151_PIXELS_PER_BYTE;
+	LOG_DBG("flush x %u-%u, y %u-%u", rect.x_start, rect.x_end,
+		rect.y_start, rect.y_end);
 
-	gpio_pin_set(driver->dc, UC8151_DC_PIN, 1);
-	if (spi_write_dt(&driver->config->bus, &buf_set)) {
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+	if (uc8151_write_window(dev, &rect, &driver->fb[offset],
+				&driver->prev[offset], UC8151_NUMOF_PAGES)) {
+		driver->num_dirty++;
 		return -EIO;
 	}
 
-	if (data != NULL) {
-		buf.buf = data;
-		buf.len = len;
-		gpio_pin_set(driver->dc, UC8151_DC_PIN, 0);
-		if (spi_write_dt(&driver->config->bus, &buf_set)) {
-			return -EIO;
-		}
+	for (uint16_t y = rect.y_start; y <= rect.y_end; y++) {
+		memcpy(&driver->prev[offset], &driver->fb[offset],
+		       (rect.x_end - rect.x_start + 1U) /
+		       UC8151_PIXELS_PER_BYTE);
+		offset += UC8151_NUMOF_PAGES;
+	}
+#else
+	if (uc8151_write_window(dev, &rect, &driver->fb[offset], NULL,
+				UC8151_NUMOF_PAGES)) {
+		driver->num_dirty++;
+		return -EIO;
 	}
+#endif
 
-	return 0;
+	return 1;
 }
 
-static inline void uc8151_busy_wait(struct uc8151_data *driver)
+static int uc8151_flush_all(const struct device *dev)
 {
-	int pin = gpio_pin_get(driver->busy, UC8151_BUSY_PIN);
+	struct uc8151_data *driver = dev->data;
 
-	while (pin > 0) {
-		__ASSERT(pin >= 0, "Failed to get pin level");
-		LOG_DBG("wait %u", pin);
-		k_sleep(K_MSEC(UC8151_BUSY_DELAY));
-		pin = gpio_pin_get(driver->busy, UC8151_BUSY_PIN);
+	uc8151_coalesce_dirty(driver);
+	while (driver->num_dirty > 0) {
+		if (uc8151_flush_window(dev) < 0) {
+			return -EIO;
+		}
 	}
+
+	return 0;
 }
 
-static int uc8151_update_display(const struct device *dev)
+int uc8151_invalidate(const struct device *dev, uint16_t x, uint16_t y,
+		      uint16_t width, uint16_t height)
 {
 	struct uc8151_data *driver = dev->data;
+	struct uc8151_rect rect;
 
-	LOG_DBG("Trigger update sequence");
-	if (uc8151_write_cmd(driver, UC8151_CMD_DRF, NULL, 0)) {
-		return -EIO;
+	UC8151_CHECK_ASYNC_IDLE(driver);
+
+	if (width == 0U || height == 0U ||
+	    (x + width > EPD_PANEL_WIDTH) || (y + height > EPD_PANEL_HEIGHT)) {
+		LOG_ERR("Position out of bounds");
+		return -EINVAL;
 	}
 
-	k_sleep(K_MSEC(UC8151_BUSY_DELAY));
+	rect.x_start = ROUND_DOWN(x, UC8151_PIXELS_PER_BYTE);
+	rect.x_end = ROUND_UP(x + width, UC8151_PIXELS_PER_BYTE) - 1U;
+	rect.y_start = y;
+	rect.y_end = y + height - 1U;
+	uc8151_mark_dirty(driver, &rect);
 
 	return 0;
 }
 
-static int uc8151_blanking_off(const struct device *dev)
+int uc8151_flush(const struct device *dev)
 {
 	struct uc8151_data *driver = dev->data;
 
-	if (blanking_on) {
-		/* Update EPD pannel in normal mode */
-		uc8151_busy_wait(driver);
-		if (uc8151_update_display(dev)) {
-			return -EIO;
-		}
+	UC8151_CHECK_ASYNC_IDLE(driver);
+
+	return uc8151_flush_all(dev);
+}
+#endif /* CONFIG_UC8151_SHADOW_FRAMEBUFFER */
+
+static inline bool uc8151_is_transposed(enum display_orientation orientation)
+{
+	return orientation == DISPLAY_ORIENTATION_ROTATED_90 ||
+	       orientation == DISPLAY_ORIENTATION_ROTATED_270;
+}
+
+/*
+ * Transpose an 8x8 bit block, MSB first. Row i of the block is read from
+ * src[i * stride], column j is stored to dst[j * dst_stride]. The block is
+ * held in two 32-bit words and transposed with three swap stages
+ * (Hacker's Delight, 7-3).
+ */
+static void uc8151_transpose8(const uint8_t *src, ptrdiff_t stride,
+			      uint8_t *dst, ptrdiff_t dst_stride)
+{
+	uint32_t x = ((uint32_t)src[0] << 24) |
+		     ((uint32_t)src[stride] << 16) |
+		     ((uint32_t)src[2 * stride] << 8) |
+		     (uint32_t)src[3 * stride];
+	uint32_t y = ((uint32_t)src[4 * stride] << 24) |
+		     ((uint32_t)src[5 * stride] << 16) |
+		     ((uint32_t)src[6 * stride] << 8) |
+		     (uint32_t)src[7 * stride];
+	uint32_t t;
+
+	/* Swap bits within 2x2, then 2-bit pairs within 4x4 blocks */
+	t = (x ^ (x >> 7)) & 0x00AA00AAU;
+	x = x ^ t ^ (t << 7);
+	t = (y ^ (y >> 7)) & 0x00AA00AAU;
+	y = y ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCCU;
+	x = x ^ t ^ (t << 14);
+	t = (y ^ (y >> 14)) & 0x0000CCCCU;
+	y = y ^ t ^ (t << 14);
+
+	/* Swap the off-diagonal 4x4 blocks between the two words */
+	t = (x & 0xF0F0F0F0U) | ((y >> 4) & 0x0F0F0F0FU);
+	y = ((x << 4) & 0xF0F0F0F0U) | (y & 0x0F0F0F0FU);
+	x = t;
+
+	dst[0] = x >> 24;
+	dst[dst_stride] = x >> 16;
+	dst[2 * dst_stride] = x >> 8;
+	dst[3 * dst_stride] = x;
+	dst[4 * dst_stride] = y >> 24;
+	dst[5 * dst_stride] = y >> 16;
+	dst[6 * dst_stride] = y >> 8;
+	dst[7 * dst_stride] = y;
+}
+
+static inline uint8_t uc8151_reverse8(uint8_t b)
+{
+	b = (b >> 4) | (b << 4);
+	b = ((b & 0xCCU) >> 2) | ((b & 0x33U) << 2);
+	b = ((b & 0xAAU) >> 1) | ((b & 0x55U) << 1);
+
+	return b;
+}
+
+/* Map a logical window of the current orientation to panel coordinates */
+static void uc8151_rotate_rect(enum display_orientation orientation,
+			       uint16_t x, uint16_t y,
+			       uint16_t width, uint16_t height,
+			       struct uc8151_rect *rect)
+{
+	switch (orientation) {
+	case DISPLAY_ORIENTATION_ROTATED_90:
+		rect->x_start = EPD_PANEL_WIDTH - y - height;
+		rect->y_start = x;
+		rect->x_end = rect->x_start + height - 1U;
+		rect->y_end = rect->y_start + width - 1U;
+		break;
+	case DISPLAY_ORIENTATION_ROTATED_180:
+		rect->x_start = EPD_PANEL_WIDTH - x - width;
+		rect->y_start = EPD_PANEL_HEIGHT - y - height;
+		rect->x_end = rect->x_start + width - 1U;
+		rect->y_end = rect->y_start + height - 1U;
+		break;
+	case DISPLAY_ORIENTATION_ROTATED_270:
+		rect->x_start = y;
+		rect->y_start = EPD_PANEL_HEIGHT - x - width;
+		rect->x_end = rect->x_start + height - 1U;
+		rect->y_end = rect->y_start + width - 1U;
+		break;
+	default:
+		rect->x_start = x;
+		rect->y_start = y;
+		rect->x_end = x + width - 1U;
+		rect->y_end = y + height - 1U;
+		break;
 	}
+}
 
-	blanking_on = false;
+/*
+ * Convert panel rows [group * 8, group * 8 + 8) of a rotated window from
+ * the logical source buffer, width x height pixels with packed rows, to
+ * dst, dst_pitch bytes apart. Returns the number of rows produced.
+ *
+ * Rotated by 90 or 270 degrees, each group of panel rows is one byte
+ * column of the source and is produced one 8x8 block at a time.
+ */
+static uint16_t uc8151_rotate_group(enum display_orientation orientation,
+				    const uint8_t *src, uint16_t width,
+				    uint16_t height, uint16_t group,
+				    uint8_t *dst, size_t dst_pitch)
+{
+	size_t pitch = width / UC8151_PIXELS_PER_BYTE;
+	uint16_t blocks = height / UC8151_PIXELS_PER_BYTE;
+	uint16_t rows;
+	const uint8_t *row;
+
+	switch (orientation) {
+	case DISPLAY_ORIENTATION_ROTATED_90:
+		/* Source bottom row ends up in the panel MSB */
+		for (uint16_t b = 0; b < blocks; b++) {
+			uc8151_transpose8(&src[(b * 8U + 7U) * pitch + group],
+					  -(ptrdiff_t)pitch,
+					  &dst[blocks - 1U - b], dst_pitch);
+		}
 
-	return 0;
+		return UC8151_ROTATE_GROUP_ROWS;
+	case DISPLAY_ORIENTATION_ROTATED_270:
+		/* Source columns map to panel rows in reverse order */
+		for (uint16_t b = 0; b < blocks; b++) {
+			uc8151_transpose8(&src[b * 8U * pitch +
+					       pitch - 1U - group],
+					  pitch, &dst[7U * dst_pitch + b],
+					  -(ptrdiff_t)dst_pitch);
+		}
+
+		return UC8151_ROTATE_GROUP_ROWS;
+	default:
+		/* Rows, bytes and bits in reverse order */
+		rows = MIN(UC8151_ROTATE_GROUP_ROWS,
+			   height - group * UC8151_ROTATE_GROUP_ROWS);
+		for (uint16_t r = 0; r < rows; r++) {
+			row = &src[(height - 1U -
+				    group * UC8151_ROTATE_GROUP_ROWS - r) * pitch];
+			for (size_t i = 0; i < pitch; i++) {
+				dst[r * dst_pitch + i] =
+					uc8151_reverse8(row[pitch - 1U - i]);
+			}
+		}
+
+		return rows;
+	}
 }
 
-static int uc8151_blanking_on(const struct device *dev)
+#ifndef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+/* Stream a rotated window through a small buffer of converted rows */
+static int uc8151_write_rotated(const struct device *dev,
+				const struct uc8151_rect *win,
+				uint16_t width, uint16_t height,
+				const uint8_t *src)
 {
-	blanking_on = true;
+	struct uc8151_data *driver = dev->data;
+	uint8_t rows[UC8151_ROTATE_GROUP_ROWS * UC8151_NUMOF_PAGES];
+	size_t row_len = (win->x_end - win->x_start + 1U) /
+			 UC8151_PIXELS_PER_BYTE;
+	uint16_t groups = DIV_ROUND_UP(win->y_end - win->y_start + 1U,
+				       UC8151_ROTATE_GROUP_ROWS);
+	struct uc8151_window_regs regs;
+	struct uc8151_batch batch;
+	uint16_t count;
+
+	if (uc8151_window_begin(dev, &batch, win, &regs)) {
+		return -EIO;
+	}
 
-	return 0;
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM2, NULL, 0);
+	for (uint16_t g = 0; g < groups; g++) {
+		count = uc8151_rotate_group(driver->orientation, src, width,
+					    height, g, rows, row_len);
+		uc8151_batch_data(driver, &batch, rows, count * row_len);
+		/* The buffer is reused for the next group */
+		uc8151_batch_flush(driver, &batch);
+	}
+
+	return uc8151_window_end(dev, &batch);
 }
+#endif /* !CONFIG_UC8151_SHADOW_FRAMEBUFFER */
 
 static int uc8151_write(const struct device *dev, const uint16_t x, const uint16_t y,
 			const struct display_buffer_descriptor *desc,
 			const void *buf)
 {
 	struct uc8151_data *driver = dev->data;
-	uint16_t x_end_idx = x + desc->width - 1;
-	uint16_t y_end_idx = y + desc->height - 1;
-	uint8_t ptl[UC8151_PTL_REG_LENGTH] = {0};
-	size_t buf_len;
+	bool transposed = uc8151_is_transposed(driver->orientation);
+	uint16_t width = transposed ? EPD_PANEL_HEIGHT : EPD_PANEL_WIDTH;
+	uint16_t height = transposed ? EPD_PANEL_WIDTH : EPD_PANEL_HEIGHT;
+	struct uc8151_rect rect;
+	size_t row_len = desc->width / UC8151_PIXELS_PER_BYTE;
 
 	LOG_DBG("x %u, y %u, height %u, width %u, pitch %u",
 		x, y, desc->height, desc->width, desc->pitch);
 
-	buf_len = MIN(desc->buf_size,
-		      desc->height * desc->width / UC8151_PIXELS_PER_BYTE);
 	__ASSERT(desc->width <= desc->pitch, "Pitch is smaller then width");
 	__ASSERT(buf != NULL, "Buffer is not available");
-	__ASSERT(buf_len != 0U, "Buffer of length zero");
+	__ASSERT(desc->buf_size != 0U, "Buffer of length zero");
 	__ASSERT(!(desc->width % UC8151_PIXELS_PER_BYTE),
 		 "Buffer width not multiple of %d", UC8151_PIXELS_PER_BYTE);
+	__ASSERT(!(x % UC8151_PIXELS_PER_BYTE),
+		 "X coordinate not multiple of %d", UC8151_PIXELS_PER_BYTE);
 
-	if ((y_end_idx > (EPD_PANEL_HEIGHT - 1)) ||
-	    (x_end_idx > (EPD_PANEL_WIDTH - 1))) {
+	if ((y + desc->height > height) || (x + desc->width > width)) {
 		LOG_ERR("Position out of bounds");
 		return -EINVAL;
 	}
 
-	/* Setup Partial Window and enable Partial Mode */
-	sys_put_be16(x, &ptl[UC8151_PTL_HRST_IDX]);
-	sys_put_be16(x_end_idx, &ptl[UC8151_PTL_HRED_IDX]);
-	sys_put_be16(y, &ptl[UC8151_PTL_VRST_IDX]);
-	sys_put_be16(y_end_idx, &ptl[UC8151_PTL_VRED_IDX]);
-	ptl[sizeof(ptl) - 1] = UC8151_PTL_PT_SCAN;
-	LOG_HEXDUMP_DBG(ptl, sizeof(ptl), "ptl");
-
-	uc8151_busy_wait(driver);
-	if (uc8151_write_cmd(driver, UC8151_CMD_PTIN, NULL, 0)) {
-		return -EIO;
+	/* Logical rows become panel columns, which are byte aligned */
+	if (transposed && ((y % UC8151_PIXELS_PER_BYTE) ||
+			   (desc->height % UC8151_PIXELS_PER_BYTE))) {
+		LOG_ERR("Y and height not multiple of %d",
+			UC8151_PIXELS_PER_BYTE);
+		return -EINVAL;
 	}
 
-	if (uc8151_write_cmd(driver, UC8151_CMD_PTL, ptl, sizeof(ptl))) {
-		return -EIO;
+	if (desc->buf_size < row_len * desc->height) {
+		LOG_ERR("Buffer too small");
+		return -EINVAL;
 	}
 
-	/* Disable boarder output */
-	bdd_polarity |= UC8151_CDI_BDZ;
-	if (uc8151_write_cmd(driver, UC8151_CMD_CDI,
-			     &bdd_polarity, sizeof(bdd_polarity))) {
-		return -EIO;
+	UC8151_CHECK_ASYNC_IDLE(driver);
+
+	uc8151_rotate_rect(driver->orientation, x, y,
+			   desc->width, desc->height, &rect);
+
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+	uint8_t *dst = &driver->fb[rect.y_start * UC8151_NUMOF_PAGES +
+				   rect.x_start / UC8151_PIXELS_PER_BYTE];
+	const uint8_t *src = buf;
+	uint16_t rows = rect.y_end - rect.y_start + 1U;
+
+	if (driver->orientation == DISPLAY_ORIENTATION_NORMAL) {
+		for (uint16_t i = 0; i < desc->height; i++) {
+			memcpy(dst, src, row_len);
+			dst += UC8151_NUMOF_PAGES;
+			src += row_len;
+		}
+	} else {
+		for (uint16_t g = 0; g * UC8151_ROTATE_GROUP_ROWS < rows; g++) {
+			uc8151_rotate_group(driver->orientation, src,
+					    desc->width, desc->height, g,
+					    dst, UC8151_NUMOF_PAGES);
+			dst += UC8151_ROTATE_GROUP_ROWS * UC8151_NUMOF_PAGES;
+		}
 	}
 
-	if (uc8151_write_cmd(driver, UC8151_CMD_DTM2, (uint8_t *)buf, buf_len)) {
-		return -EIO;
+	uc8151_mark_dirty(driver, &rect);
+
+	return 0;
+#else
+	if (driver->orientation != DISPLAY_ORIENTATION_NORMAL) {
+		return uc8151_write_rotated(dev, &rect, desc->width,
+					    desc->height, buf);
 	}
 
-	/* Update partial window and disable Partial Mode */
-	if (blanking_on == false) {
+	return uc8151_write_window(dev, &rect, buf, NULL, row_len);
+#endif
+}
+
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+/*
+ * Start the next step of an asynchronous refresh. Returns a positive value
+ * when a refresh was started and BUSY has to be awaited, 0 when there is
+ * nothing left to do.
+ */
+static int uc8151_refresh_step(const struct device *dev)
+{
+	if (blanking_on) {
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+		if (uc8151_flush_all(dev)) {
+			return -EIO;
+		}
+#endif
 		if (uc8151_update_display(dev)) {
 			return -EIO;
 		}
+
+		blanking_on = false;
+		return 1;
+	}
+
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+	struct uc8151_data *driver = dev->data;
+	int err;
+
+	uc8151_coalesce_dirty(driver);
+	while (driver->num_dirty > 0) {
+		err = uc8151_flush_window(dev);
+		if (err) {
+			return err;
+		}
+	}
+#endif
+
+	return 0;
+}
+
+static void uc8151_refresh_work_handler(struct k_work *work)
+{
+	struct uc8151_data *driver =
+		CONTAINER_OF(work, struct uc8151_data, refresh_work);
+	const struct device *dev = DEVICE_DT_INST_GET(0);
+	uc8151_refresh_cb_t cb = driver->refresh_cb;
+	void *user_data = driver->refresh_user_data;
+	int err;
+
+	err = uc8151_refresh_step(dev);
+	if (err > 0) {
+		atomic_set(&driver->async_armed, 1);
+		if (!uc8151_busy_arm(driver)) {
+			return;
+		}
+
+		atomic_clear(&driver->async_armed);
+		err = -EIO;
+	}
+
+	uc8151_refresh_done(driver);
+	driver->refresh_cb = NULL;
+	atomic_clear(&driver->async_busy);
+
+	if (cb != NULL) {
+		cb(dev, err, user_data);
+	}
+}
+
+int uc8151_refresh_async(const struct device *dev,
+			 uc8151_refresh_cb_t cb, void *user_data)
+{
+	struct uc8151_data *driver = dev->data;
+
+	if (!atomic_cas(&driver->async_busy, 0, 1)) {
+		return -EBUSY;
 	}
 
-	/* Enable boarder output */
-	bdd_polarity &= ~UC8151_CDI_BDZ;
-	if (uc8151_write_cmd(driver, UC8151_CMD_CDI,
-			     &bdd_polarity, sizeof(bdd_polarity))) {
+	driver->refresh_cb = cb;
+	driver->refresh_user_data = user_data;
+
+	/* Steps run from the work handler once BUSY is released */
+	atomic_set(&driver->async_armed, 1);
+	if (uc8151_busy_arm(driver)) {
+		atomic_clear(&driver->async_armed);
+		driver->refresh_cb = NULL;
+		atomic_clear(&driver->async_busy);
 		return -EIO;
 	}
 
-	if (uc8151_write_cmd(driver, UC8151_CMD_PTOUT, NULL, 0)) {
+	return 0;
+}
+#endif /* CONFIG_UC8151_BUSY_INTERRUPT */
+
+int uc8151_set_power_state(const struct device *dev,
+			   enum uc8151_power_state state)
+{
+	struct uc8151_data *driver = dev->data;
+	uint8_t check = UC8151_DSLP_CHECK_CODE;
+
+	UC8151_CHECK_ASYNC_IDLE(driver);
+
+	if (state == UC8151_POWER_DEEP_SLEEP &&
+	    !IS_ENABLED(CONFIG_UC8151_SHADOW_FRAMEBUFFER)) {
+		return -ENOTSUP;
+	}
+
+	if (state == UC8151_POWER_DEEP_SLEEP) {
+		if (uc8151_busy_wait(driver)) {
+			return -EIO;
+		}
+	} else if (uc8151_wake(dev)) {
 		return -EIO;
 	}
 
+	if (state == driver->power) {
+		return 0;
+	}
+
+	if (state == UC8151_POWER_ACTIVE) {
+		return uc8151_power_on(driver);
+	}
+
+	/* Deep sleep is entered from the powered off state */
+	if (driver->power == UC8151_POWER_ACTIVE) {
+		if (uc8151_write_cmd(driver, UC8151_CMD_POF, NULL, 0) ||
+		    uc8151_busy_wait_pin(driver)) {
+			return -EIO;
+		}
+
+		uc8151_power_set(driver, UC8151_POWER_OFF, k_uptime_get_32());
+	}
+
+	if (state == UC8151_POWER_DEEP_SLEEP) {
+		if (uc8151_write_cmd(driver, UC8151_CMD_DSLP,
+				     &check, sizeof(check))) {
+			return -EIO;
+		}
+
+		uc8151_power_set(driver, UC8151_POWER_DEEP_SLEEP,
+				 k_uptime_get_32());
+	}
+
 	return 0;
 }
 
+void uc8151_get_power_stats(const struct device *dev,
+			    struct uc8151_power_stats *stats)
+{
+	struct uc8151_data *driver = dev->data;
+
+	if (driver->refresh_pending &&
+	    gpio_pin_get(driver->busy, UC8151_BUSY_PIN) == 0) {
+		uc8151_refresh_done(driver);
+	}
+
+	*stats = driver->power_stats;
+	stats->state = driver->power;
+	stats->time_ms[driver->power] += k_uptime_get_32() -
+					 driver->power_since;
+}
+
+int uc8151_wait_idle(const struct device *dev)
+{
+	struct uc8151_data *driver = dev->data;
+
+	UC8151_CHECK_ASYNC_IDLE(driver);
+
+	return uc8151_busy_wait(driver);
+}
+
+#ifdef CONFIG_UC8151_STATS
+void uc8151_get_stats(const struct device *dev, struct uc8151_stats *stats)
+{
+	struct uc8151_data *driver = dev->data;
+
+	*stats = driver->stats;
+}
+
+void uc8151_reset_stats(const struct device *dev)
+{
+	struct uc8151_data *driver = dev->data;
+
+	memset(&driver->stats, 0, sizeof(driver->stats));
+}
+#endif /* CONFIG_UC8151_STATS */
+
+#ifdef CONFIG_PM_DEVICE
+static int uc8151_pm_action(const struct device *dev,
+			    enum pm_device_action action)
+{
+	switch (action) {
+	case PM_DEVICE_ACTION_SUSPEND:
+	case PM_DEVICE_ACTION_TURN_OFF:
+		return uc8151_set_power_state(dev,
+			IS_ENABLED(CONFIG_UC8151_SHADOW_FRAMEBUFFER) ?
+			UC8151_POWER_DEEP_SLEEP : UC8151_POWER_OFF);
+	case PM_DEVICE_ACTION_RESUME:
+		/* Woken up by the next access */
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+}
+#endif /* CONFIG_PM_DEVICE */
+
 static int uc8151_read(const struct device *dev, const uint16_t x, const uint16_t y,
 		       const struct display_buffer_descriptor *desc, void *buf)
 {
@@ -222,8 +1523,14 @@ static int uc8151_read(const struct device *dev, const uint16_t x, const uint16_
 
 static void *uc8151_get_framebuffer(const struct device *dev)
 {
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+	struct uc8151_data *driver = dev->data;
+
+	return driver->fb;
+#else
 	LOG_ERR("not supported");
 	return NULL;
+#endif
 }
 
 static int uc8151_set_brightness(const struct device *dev,
@@ -242,20 +1549,41 @@ static int uc8151_set_contrast(const struct device *dev, uint8_t contrast)
 static void uc8151_get_capabilities(const struct device *dev,
 				    struct display_capabilities *caps)
 {
+	struct uc8151_data *driver = dev->data;
+
 	memset(caps, 0, sizeof(struct display_capabilities));
-	caps->x_resolution = EPD_PANEL_WIDTH;
-	caps->y_resolution = EPD_PANEL_HEIGHT;
+	if (uc8151_is_transposed(driver->orientation)) {
+		caps->x_resolution = EPD_PANEL_HEIGHT;
+		caps->y_resolution = EPD_PANEL_WIDTH;
+	} else {
+		caps->x_resolution = EPD_PANEL_WIDTH;
+		caps->y_resolution = EPD_PANEL_HEIGHT;
+	}
+
 	caps->supported_pixel_formats = PIXEL_FORMAT_MONO10;
 	caps->current_pixel_format = PIXEL_FORMAT_MONO10;
 	caps->screen_info = SCREEN_INFO_MONO_MSB_FIRST | SCREEN_INFO_EPD;
+	caps->current_orientation = driver->orientation;
 }
 
 static int uc8151_set_orientation(const struct device *dev,
 				  const enum display_orientation
 				  orientation)
 {
-	LOG_ERR("Unsupported");
-	return -ENOTSUP;
+	struct uc8151_data *driver = dev->data;
+
+	if (orientation > DISPLAY_ORIENTATION_ROTATED_270) {
+		LOG_ERR("Unsupported");
+		return -ENOTSUP;
+	}
+
+	/*
+	 * Only the mapping of later writes changes, the panel content and
+	 * the shadow framebuffer stay in panel orientation.
+	 */
+	driver->orientation = orientation;
+
+	return 0;
 }
 
 static int uc8151_set_pixel_format(const struct device *dev,
@@ -272,25 +1600,47 @@ static int uc8151_set_pixel_format(const struct device *dev,
 static int uc8151_clear_and_write_buffer(const struct device *dev,
 					 uint8_t pattern, bool update)
 {
-	struct display_buffer_descriptor desc = {
-		.buf_size = UC8151_NUMOF_PAGES,
-		.width = EPD_PANEL_WIDTH,
-		.height = 1,
-		.pitch = EPD_PANEL_WIDTH,
-	};
-	uint8_t *line;
+	struct uc8151_data *driver = dev->data;
+	uint8_t chunk[UC8151_FILL_CHUNK_SIZE];
+	struct uc8151_batch batch;
+	size_t remaining = UC8151_FB_SIZE;
+
+	memset(chunk, pattern, sizeof(chunk));
+
+	/* Outside of partial mode DTM2 fills the whole frame */
+	if (uc8151_wake(dev)) {
+		return -EIO;
+	}
 
-	line = k_malloc(UC8151_NUMOF_PAGES);
-	if (line == NULL) {
-		return -ENOMEM;
+	uc8151_batch_init(driver, &batch);
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+	/* Keep the previous frame consistent for differential updates */
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM1, NULL, 0);
+	for (size_t i = 0; i < UC8151_FB_SIZE; i += sizeof(chunk)) {
+		uc8151_batch_data(driver, &batch, chunk,
+				  MIN(UC8151_FB_SIZE - i, sizeof(chunk)));
+	}
+#endif
+
+	uc8151_batch_cmd(driver, &batch, UC8151_CMD_DTM2, NULL, 0);
+	/* Every data buffer points at the same pattern chunk */
+	while (remaining > 0) {
+		uc8151_batch_data(driver, &batch, chunk,
+				  MIN(remaining, sizeof(chunk)));
+		remaining -= MIN(remaining, sizeof(chunk));
 	}
 
-	memset(line, pattern, UC8151_NUMOF_PAGES);
-	for (int i = 0; i < EPD_PANEL_HEIGHT; i++) {
-		uc8151_write(dev, 0, i, &desc, line);
+	if (uc8151_batch_end(driver, &batch)) {
+		return -EIO;
 	}
 
-	k_free(line);
+#ifdef CONFIG_UC8151_SHADOW_FRAMEBUFFER
+	memset(driver->fb, pattern, sizeof(driver->fb));
+#ifdef CONFIG_UC8151_DIFFERENTIAL_REFRESH
+	memset(driver->prev, pattern, sizeof(driver->prev));
+#endif
+	driver->num_dirty = 0;
+#endif
 
 	if (update == true) {
 		if (uc8151_update_display(dev)) {
@@ -304,72 +1654,13 @@ static int uc8151_clear_and_write_buffer(const struct device *dev,
 static int uc8151_controller_init(const struct device *dev)
 {
 	struct uc8151_data *driver = dev->data;
-	uint8_t tmp[UC8151_TRES_REG_LENGTH];
-	
-	gpio_pin_set(driver->reset, UC8151_RESET_PIN, 1);
-	k_sleep(K_MSEC(UC8151_RESET_DELAY));
-	gpio_pin_set(driver->reset, UC8151_RESET_PIN, 0);
-	k_sleep(K_MSEC(UC8151_RESET_DELAY));
-
-	uc8151_busy_wait(driver);
-
-	LOG_DBG("Initialize UC8151 controller");
-
-	if (uc8151_write_cmd(driver, UC8151_CMD_PWR, uc8151_pwr,
-			     sizeof(uc8151_pwr))) {
-		return -EIO;
-	}
-
-	if (uc8151_write_cmd(driver, UC8151_CMD_BTST,
-			     uc8151_softstart, sizeof(uc8151_softstart))) {
-		return -EIO;
-	}
 
-	/* Turn on: booster, controller, regulators, and sensor. */
-	if (uc8151_write_cmd(driver, UC8151_CMD_PON, NULL, 0)) {
-		return -EIO;
-	}
-
-	k_sleep(K_MSEC(UC8151_PON_DELAY));
-	uc8151_busy_wait(driver);
-
-	/* Pannel settings, KW mode */
-	tmp[0] = UC8151_PSR_KW_R |
-		 UC8151_PSR_UD |
-		 UC8151_PSR_SHL |
-		 UC8151_PSR_SHD |
-		 UC8151_PSR_RST;
-	if (uc8151_write_cmd(driver, UC8151_CMD_PSR, tmp, 1)) {
-		return -EIO;
-	}
-
-	/* Set panel resolution */
-	sys_put_be16(EPD_PANEL_WIDTH, &tmp[UC8151_TRES_HRES_IDX]);
-	sys_put_be16(EPD_PANEL_HEIGHT, &tmp[UC8151_TRES_VRES_IDX]);
-	LOG_HEXDUMP_DBG(tmp, sizeof(tmp), "TRES");
-	if (uc8151_write_cmd(driver, UC8151_CMD_TRES,
-			     tmp, UC8151_TRES_REG_LENGTH)) {
-		return -EIO;
-	}
-
-	bdd_polarity = UC8151_CDI_BDV1 |
-		       UC8151_CDI_N2OCP | UC8151_CDI_DDX0;
-	tmp[UC8151_CDI_BDZ_DDX_IDX] = bdd_polarity;
-	tmp[UC8151_CDI_CDI_IDX] = DT_INST_PROP(0, cdi);
-	LOG_HEXDUMP_DBG(tmp, UC8151_CDI_REG_LENGTH, "CDI");
-	if (uc8151_write_cmd(driver, UC8151_CMD_CDI, tmp,
-			     UC8151_CDI_REG_LENGTH)) {
+	if (uc8151_controller_setup(dev)) {
 		return -EIO;
 	}
 
-	tmp[0] = DT_INST_PROP(0, tcon);
-	if (uc8151_write_cmd(driver, UC8151_CMD_TCON, tmp, 1)) {
-		return -EIO;
-	}
-
-	/* Enable Auto Sequence */
-	tmp[0] = UC8151_AUTO_PON_DRF_POF;
-	if (uc8151_write_cmd(driver, UC8151_CMD_AUTO, tmp, 1)) {
+	if (UC8151_POWER_AFTER_REFRESH == UC8151_POWER_ACTIVE &&
+	    uc8151_power_on(driver)) {
 		return -EIO;
 	}
 
@@ -419,18 +1710,32 @@ static int uc8151_init(const struct device *dev)
 	gpio_pin_configure(driver->busy, UC8151_BUSY_PIN,
 			   GPIO_INPUT | UC8151_BUSY_FLAGS);
 
+	driver->power = UC8151_POWER_OFF;
+	driver->power_since = k_uptime_get_32();
+
+#ifdef CONFIG_UC8151_BUSY_INTERRUPT
+	k_sem_init(&driver->busy_sem, 0, 1);
+	k_work_init(&driver->refresh_work, uc8151_refresh_work_handler);
+	gpio_init_callback(&driver->busy_cb, uc8151_busy_handler,
+			   BIT(UC8151_BUSY_PIN));
+	if (gpio_add_callback(driver->busy, &driver->busy_cb)) {
+		LOG_ERR("Could not set UC8151 busy callback");
+		return -EIO;
+	}
+#endif
+
 	return uc8151_controller_init(dev);
 }
 
-static struct uc8151_data uc8151_driver = {
-	.config = &uc8151_config
-};
-
-static const struct uc8151_config uc8151_config {
+static const struct uc8151_config uc8151_config = {
 	.bus = SPI_DT_SPEC_INST_GET(
 		0, SPI_OP_MODE_MASTER | SPI_WORD_SET(8), 0)
 };
 
+static struct uc8151_data uc8151_driver = {
+	.config = &uc8151_config
+};
+
 static struct display_driver_api uc8151_driver_api = {
 	.blanking_on = uc8151_blanking_on,
 	.blanking_off = uc8151_blanking_off,
@@ -445,7 +1750,9 @@ static struct display_driver_api uc8151_driver_api = {
 };
 
 
-DEVICE_DT_INST_DEFINE(0, uc8151_init, NULL,
+PM_DEVICE_DT_INST_DEFINE(0, uc8151_pm_action);
+
+DEVICE_DT_INST_DEFINE(0, uc8151_init, PM_DEVICE_DT_INST_REF(0),
 		      &uc8151_driver, &uc8151_config,
 		      POST_KERNEL, CONFIG_DISPLAY_INIT_PRIORITY,
 		      &uc8151_driver_api);
\ No newline at end of file
@@ -58,6 +58,8 @@
 #define UC8151_AUTO_PON_DRF_POF			0xA5
 #define UC8151_AUTO_PON_DRF_POF_DSLP		0xA7
 
+#define UC8151_DSLP_CHECK_CODE			0xA5
+
 #define UC8151_CDI_REG_LENGTH			2U
 #define UC8151_CDI_BDZ_DDX_IDX			0
 #define UC8151_CDI_CDI_IDX			1
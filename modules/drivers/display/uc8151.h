@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2020 PHYTEC Messtechnik GmbH
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_DRIVERS_DISPLAY_UC8151_H_
+#define ZEPHYR_DRIVERS_DISPLAY_UC8151_H_
+
+#include <device.h>
+
+#ifdef CONFIG_UC8151_EMUL
+#include "uc8151_emul.h"
+#endif
+
+/**
+ * @brief Mark a region of the shadow framebuffer as dirty.
+ *
+ * For callers drawing directly into the buffer returned by
+ * display_get_framebuffer(). The region is widened to whole bytes.
+ * The framebuffer and the region are in panel orientation, regardless of
+ * display_set_orientation().
+ *
+ * Only available with CONFIG_UC8151_SHADOW_FRAMEBUFFER.
+ *
+ * @param dev UC8151 device
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the region is empty or out of bounds
+ * @retval -EBUSY if an asynchronous refresh is in progress
+ */
+int uc8151_invalidate(const struct device *dev, uint16_t x, uint16_t y,
+		      uint16_t width, uint16_t height);
+
+/**
+ * @brief Push the dirty regions of the shadow framebuffer to the panel.
+ *
+ * Dirty rectangles recorded by display_write() are merged into as few
+ * partial windows as possible. Each window is refreshed unless blanking
+ * is on, in which case the next blanking_off() refreshes the whole panel.
+ *
+ * Only available with CONFIG_UC8151_SHADOW_FRAMEBUFFER.
+ *
+ * @param dev UC8151 device
+ *
+ * @retval 0 on success
+ * @retval -EBUSY if an asynchronous refresh is in progress
+ * @retval -EIO on bus error
+ */
+int uc8151_flush(const struct device *dev);
+
+/**
+ * @brief Callback invoked when an asynchronous refresh has completed.
+ *
+ * Runs from the system work queue.
+ *
+ * @param dev UC8151 device
+ * @param status 0 on success, negative errno otherwise
+ * @param user_data Pointer passed to uc8151_refresh_async()
+ */
+typedef void (*uc8151_refresh_cb_t)(const struct device *dev, int status,
+				    void *user_data);
+
+/**
+ * @brief Refresh the panel without blocking the caller.
+ *
+ * In shadow framebuffer mode the pending dirty windows are pushed and
+ * refreshed one after another, each step started when BUSY is released.
+ * If blanking is on, the whole panel is refreshed and blanking is turned
+ * off, like blanking_off() does. Otherwise the callback fires once the
+ * controller has finished the last refresh.
+ *
+ * Display writes and flushes fail with -EBUSY until the callback ran.
+ *
+ * Only available with CONFIG_UC8151_BUSY_INTERRUPT.
+ *
+ * @param dev UC8151 device
+ * @param cb Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ *
+ * @retval 0 on success
+ * @retval -EBUSY if an asynchronous refresh is already in progress
+ * @retval -EIO if the BUSY interrupt could not be armed
+ */
+int uc8151_refresh_async(const struct device *dev,
+			 uc8151_refresh_cb_t cb, void *user_data);
+
+/** @brief Controller power states */
+enum uc8151_power_state {
+	/** Booster and regulators on, ready to refresh */
+	UC8151_POWER_ACTIVE,
+	/** Powered off, registers and frame memory retained */
+	UC8151_POWER_OFF,
+	/** Deep sleep, left through a reset and register setup */
+	UC8151_POWER_DEEP_SLEEP,
+	UC8151_POWER_STATE_COUNT,
+};
+
+/** @brief Power statistics since boot */
+struct uc8151_power_stats {
+	/** Current state */
+	enum uc8151_power_state state;
+	/** Time spent in each state, a refresh counts as active */
+	uint64_t time_ms[UC8151_POWER_STATE_COUNT];
+	/** Number of wake ups from deep sleep */
+	uint32_t wakeups;
+	/** Duration of the last reset and register setup */
+	uint32_t last_wake_ms;
+	/** From the last wake up to the end of the refresh that followed */
+	uint32_t last_wake_to_pixels_ms;
+	/** Longest wake to pixels latency seen */
+	uint32_t max_wake_to_pixels_ms;
+};
+
+/**
+ * @brief Move the controller to a power state.
+ *
+ * Waits for a running refresh first. Any state is left automatically
+ * when the panel is accessed again; see also
+ * CONFIG_UC8151_POWER_AFTER_REFRESH for the state entered after each
+ * refresh.
+ *
+ * @param dev UC8151 device
+ * @param state Target state
+ *
+ * @retval 0 on success
+ * @retval -ENOTSUP for deep sleep without CONFIG_UC8151_SHADOW_FRAMEBUFFER,
+ *         the frame memory could not be restored
+ * @retval -EBUSY if an asynchronous refresh is in progress
+ * @retval -EIO on bus error
+ */
+int uc8151_set_power_state(const struct device *dev,
+			   enum uc8151_power_state state);
+
+/**
+ * @brief Get the power statistics.
+ *
+ * The end of a refresh is taken from the BUSY interrupt with
+ * CONFIG_UC8151_BUSY_INTERRUPT. Otherwise it is noticed on the next
+ * access only.
+ *
+ * @param dev UC8151 device
+ * @param stats Filled with the current statistics
+ */
+void uc8151_get_power_stats(const struct device *dev,
+			    struct uc8151_power_stats *stats);
+
+/**
+ * @brief Wait until the controller has finished the running refresh.
+ *
+ * @param dev UC8151 device
+ *
+ * @retval 0 on success
+ * @retval -EBUSY if an asynchronous refresh is in progress
+ * @retval -ETIMEDOUT if BUSY was not released in time
+ */
+int uc8151_wait_idle(const struct device *dev);
+
+/** @brief Controller interface statistics */
+struct uc8151_stats {
+	/** Command bytes sent */
+	uint32_t commands;
+	/** Parameter and pixel bytes sent */
+	uint32_t payload_bytes;
+	/** SPI transfers, one per run of buffers at the same DC level */
+	uint32_t transfers;
+	/** Changes of the DC line between transfers */
+	uint32_t dc_toggles;
+	/** Waits that found BUSY asserted */
+	uint32_t busy_waits;
+	/** Time spent waiting for BUSY */
+	uint32_t busy_wait_ms;
+	/** Refreshes started */
+	uint32_t refreshes;
+	/** Time from refresh start to BUSY release, as far as seen */
+	uint32_t refresh_ms;
+	/** Controller resets and register setups */
+	uint32_t resets;
+};
+
+/**
+ * @brief Get the interface statistics.
+ *
+ * Only available with CONFIG_UC8151_STATS.
+ *
+ * @param dev UC8151 device
+ * @param stats Filled with the counters since the last reset
+ */
+void uc8151_get_stats(const struct device *dev, struct uc8151_stats *stats);
+
+/**
+ * @brief Reset the interface statistics.
+ *
+ * Only available with CONFIG_UC8151_STATS.
+ *
+ * @param dev UC8151 device
+ */
+void uc8151_reset_stats(const struct device *dev);
+
+/** @brief Benchmark steps, in the order they are meant to run */
+enum uc8151_bench_step {
+	/** Wake up from deep sleep */
+	UC8151_BENCH_INIT,
+	/** Clear the whole frame to white */
+	UC8151_BENCH_CLEAR,
+	/** Draw a checkerboard over the whole frame */
+	UC8151_BENCH_FULL,
+	/** Draw one tile in the middle */
+	UC8151_BENCH_PARTIAL,
+	/** Draw one tile in each corner */
+	UC8151_BENCH_CORNERS,
+	UC8151_BENCH_STEP_COUNT,
+};
+
+/** @brief Costs of a benchmark step */
+struct uc8151_bench_result {
+	/** From the start of the step to the end of its last refresh */
+	uint32_t time_ms;
+	/** Interface statistics of the step */
+	struct uc8151_stats stats;
+#ifdef CONFIG_UC8151_EMUL
+	/** What the emulated controller received and did */
+	struct uc8151_emul_stats emul;
+#endif
+};
+
+/**
+ * @brief Get the name of a benchmark step.
+ *
+ * Only available with CONFIG_UC8151_BENCH.
+ *
+ * @param step Benchmark step
+ *
+ * @return Short name of the step
+ */
+const char *uc8151_bench_name(enum uc8151_bench_step step);
+
+/**
+ * @brief Run a benchmark step.
+ *
+ * Draws the test pattern of the step into the shadow framebuffer, flushes
+ * it and waits for the last refresh. Blanking has to be off for the
+ * windows to reach the panel. The init step first puts the controller
+ * into deep sleep, only the wake up is measured.
+ *
+ * Only available with CONFIG_UC8151_BENCH.
+ *
+ * @param dev UC8151 device
+ * @param step Benchmark step
+ * @param result Filled with the costs of the step
+ *
+ * @retval 0 on success
+ * @retval -errno from the driver call that failed
+ */
+int uc8151_bench_run(const struct device *dev, enum uc8151_bench_step step,
+		     struct uc8151_bench_result *result);
+
+#endif /* ZEPHYR_DRIVERS_DISPLAY_UC8151_H_ */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2020 PHYTEC Messtechnik GmbH
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT gooddisplay_uc8151
+
+#include <string.h>
+#include <device.h>
+#include <drivers/display.h>
+
+#include "uc8151.h"
+
+#define UC8151_BENCH_WIDTH		DT_INST_PROP(0, width)
+#define UC8151_BENCH_HEIGHT		DT_INST_PROP(0, height)
+#define UC8151_BENCH_PITCH		(UC8151_BENCH_WIDTH / 8U)
+#define UC8151_BENCH_FB_SIZE		(UC8151_BENCH_PITCH * \
+					 UC8151_BENCH_HEIGHT)
+#define UC8151_BENCH_TILE		16U
+
+static void fill_tile(uint8_t *fb, uint16_t x, uint16_t y, uint8_t pattern)
+{
+	for (uint16_t row = y; row < y + UC8151_BENCH_TILE; row++) {
+		memset(&fb[row * UC8151_BENCH_PITCH + x / 8U], pattern,
+		       UC8151_BENCH_TILE / 8U);
+	}
+}
+
+static int bench_init(const struct device *dev, uint8_t *fb)
+{
+	/* Wake from deep sleep through the fast re-init path */
+	return uc8151_set_power_state(dev, UC8151_POWER_OFF);
+}
+
+static int bench_clear(const struct device *dev, uint8_t *fb)
+{
+	memset(fb, 0xff, UC8151_BENCH_FB_SIZE);
+	uc8151_invalidate(dev, 0, 0, UC8151_BENCH_WIDTH, UC8151_BENCH_HEIGHT);
+
+	return uc8151_flush(dev);
+}
+
+static int bench_full(const struct device *dev, uint8_t *fb)
+{
+	/* 8x8 checkerboard */
+	for (size_t i = 0; i < UC8151_BENCH_FB_SIZE; i++) {
+		fb[i] = ((i / UC8151_BENCH_PITCH / 8U + i) & 1U) ? 0x00 : 0xff;
+	}
+
+	uc8151_invalidate(dev, 0, 0, UC8151_BENCH_WIDTH, UC8151_BENCH_HEIGHT);
+
+	return uc8151_flush(dev);
+}
+
+static int bench_partial(const struct device *dev, uint8_t *fb)
+{
+	uint16_t x = (UC8151_BENCH_WIDTH - UC8151_BENCH_TILE) / 2U;
+	uint16_t y = (UC8151_BENCH_HEIGHT - UC8151_BENCH_TILE) / 2U;
+
+	fill_tile(fb, x, y, 0x00);
+	uc8151_invalidate(dev, x, y, UC8151_BENCH_TILE, UC8151_BENCH_TILE);
+
+	return uc8151_flush(dev);
+}
+
+static int bench_corners(const struct device *dev, uint8_t *fb)
+{
+	uint16_t x = UC8151_BENCH_WIDTH - UC8151_BENCH_TILE;
+	uint16_t y = UC8151_BENCH_HEIGHT - UC8151_BENCH_TILE;
+
+	fill_tile(fb, 0, 0, 0x55);
+	fill_tile(fb, x, 0, 0x55);
+	fill_tile(fb, 0, y, 0x55);
+	fill_tile(fb, x, y, 0x55);
+	uc8151_invalidate(dev, 0, 0, UC8151_BENCH_TILE, UC8151_BENCH_TILE);
+	uc8151_invalidate(dev, x, 0, UC8151_BENCH_TILE, UC8151_BENCH_TILE);
+	uc8151_invalidate(dev, 0, y, UC8151_BENCH_TILE, UC8151_BENCH_TILE);
+	uc8151_invalidate(dev, x, y, UC8151_BENCH_TILE, UC8151_BENCH_TILE);
+
+	return uc8151_flush(dev);
+}
+
+static const struct {
+	const char *name;
+	int (*run)(const struct device *dev, uint8_t *fb);
+} bench_steps[] = {
+	[UC8151_BENCH_INIT] = { "init", bench_init },
+	[UC8151_BENCH_CLEAR] = { "clear", bench_clear },
+	[UC8151_BENCH_FULL] = { "full", bench_full },
+	[UC8151_BENCH_PARTIAL] = { "partial", bench_partial },
+	[UC8151_BENCH_CORNERS] = { "corners", bench_corners },
+};
+
+BUILD_ASSERT(ARRAY_SIZE(bench_steps) == UC8151_BENCH_STEP_COUNT,
+	     "Every benchmark step needs a name and a function");
+
+const char *uc8151_bench_name(enum uc8151_bench_step step)
+{
+	return bench_steps[step].name;
+}
+
+int uc8151_bench_run(const struct device *dev, enum uc8151_bench_step step,
+		     struct uc8151_bench_result *result)
+{
+	uint8_t *fb = display_get_framebuffer(dev);
+	uint32_t start;
+	int err;
+
+	err = uc8151_wait_idle(dev);
+	if (!err && step == UC8151_BENCH_INIT) {
+		err = uc8151_set_power_state(dev, UC8151_POWER_DEEP_SLEEP);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	uc8151_reset_stats(dev);
+#ifdef CONFIG_UC8151_EMUL
+	uc8151_emul_reset_stats();
+#endif
+
+	start = k_uptime_get_32();
+	err = bench_steps[step].run(dev, fb);
+	if (!err) {
+		err = uc8151_wait_idle(dev);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	result->time_ms = k_uptime_get_32() - start;
+	uc8151_get_stats(dev, &result->stats);
+#ifdef CONFIG_UC8151_EMUL
+	uc8151_emul_get_stats(&result->emul);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2020 PHYTEC Messtechnik GmbH
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT gooddisplay_uc8151
+
+#include <string.h>
+#include <device.h>
+#include <drivers/emul.h>
+#include <drivers/gpio.h>
+#include <drivers/gpio/gpio_emul.h>
+#include <drivers/spi.h>
+#include <drivers/spi_emul.h>
+#include <sys/byteorder.h>
+
+#include "display_uc8151.h"
+#include "uc8151_emul.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(uc8151_emul, CONFIG_DISPLAY_LOG_LEVEL);
+
+/**
+ * UC8151 emulated on the SPI emulator controller, for native_posix.
+ *
+ * The lines are modelled at their physical levels: DC low selects a
+ * command, RESET low holds the controller in reset and BUSY is pulled
+ * low while the controller works. Only the resolution, the partial
+ * window and the frame memory are modelled, the other registers are
+ * accepted without effect.
+ */
+
+#define UC8151_EMUL_WIDTH		DT_INST_PROP(0, width)
+#define UC8151_EMUL_HEIGHT		DT_INST_PROP(0, height)
+#define UC8151_EMUL_PITCH		(UC8151_EMUL_WIDTH / 8U)
+#define UC8151_EMUL_FRAME_SIZE		(UC8151_EMUL_PITCH * \
+					 UC8151_EMUL_HEIGHT)
+
+#define UC8151_EMUL_RESET_PIN		DT_INST_GPIO_PIN(0, reset_gpios)
+#define UC8151_EMUL_DC_PIN		DT_INST_GPIO_PIN(0, dc_gpios)
+#define UC8151_EMUL_BUSY_PIN		DT_INST_GPIO_PIN(0, busy_gpios)
+
+/* RESET is sampled this often, the driver holds it for UC8151_RESET_DELAY */
+#define UC8151_EMUL_PIN_POLL_MS		1U
+
+/* No command since the reset */
+#define UC8151_EMUL_CMD_NONE		0xFFU
+
+/* Inclusive, x in bytes */
+struct uc8151_emul_window {
+	uint16_t x_start;
+	uint16_t x_end;
+	uint16_t y_start;
+	uint16_t y_end;
+};
+
+struct uc8151_emul_data {
+	struct spi_emul spi;
+	const struct device *reset;
+	const struct device *dc;
+	const struct device *busy;
+	struct k_timer busy_timer;
+	struct k_timer pin_timer;
+	struct k_spinlock lock;
+
+	/* BUSY can be driven once the driver configured it as an input */
+	bool busy_driven;
+	bool busy_on;
+	uint32_t busy_start;
+	bool in_reset;
+	bool dc_cmd;
+
+	bool powered;
+	bool asleep;
+	/* Deep sleep is entered once BUSY is released */
+	bool sleep_after_busy;
+	bool partial;
+	bool tres_set;
+	bool ptl_set;
+	struct uc8151_emul_window ptl;
+
+	uint8_t cmd;
+	/* Parameter bytes received for cmd */
+	size_t count;
+	/* The command was rejected, its parameters are dropped */
+	bool cmd_ignored;
+	/* An error was counted for cmd, don't repeat it for every byte */
+	bool cmd_failed;
+	uint8_t params[UC8151_PTL_REG_LENGTH];
+
+	struct uc8151_emul_stats stats;
+
+	/* Frame memory, old data through DTM1 and new data through DTM2 */
+	uint8_t old_frame[UC8151_EMUL_FRAME_SIZE];
+	uint8_t new_frame[UC8151_EMUL_FRAME_SIZE];
+	uint8_t panel[UC8151_EMUL_FRAME_SIZE];
+	/* The panel went through a full refresh */
+	bool panel_known;
+};
+
+static struct uc8151_emul_data uc8151_emul_data;
+
+static void uc8151_emul_error(struct uc8151_emul_data *data, const char *what)
+{
+	if (data->cmd_failed) {
+		return;
+	}
+
+	data->cmd_failed = true;
+	data->stats.errors++;
+	LOG_WRN("Command 0x%02x: %s", data->cmd, what);
+}
+
+/* Assert BUSY for ms, the caller drives the pin */
+static void uc8151_emul_busy(struct uc8151_emul_data *data, uint32_t ms)
+{
+	data->busy_on = true;
+	data->busy_start = k_uptime_get_32();
+	data->stats.busy_periods++;
+	k_timer_start(&data->busy_timer, K_MSEC(ms), K_NO_WAIT);
+}
+
+/* Deep sleep keeps neither the registers nor the frame memory */
+static void uc8151_emul_sleep(struct uc8151_emul_data *data)
+{
+	data->asleep = true;
+	data->powered = false;
+	data->partial = false;
+	data->tres_set = false;
+	data->ptl_set = false;
+	memset(data->old_frame, 0, sizeof(data->old_frame));
+	memset(data->new_frame, 0, sizeof(data->new_frame));
+}
+
+static void uc8151_emul_reset(struct uc8151_emul_data *data)
+{
+	k_timer_stop(&data->busy_timer);
+	data->busy_on = false;
+	data->asleep = false;
+	data->sleep_after_busy = false;
+	data->powered = false;
+	data->partial = false;
+	data->tres_set = false;
+	data->ptl_set = false;
+	data->cmd = UC8151_EMUL_CMD_NONE;
+	data->count = 0U;
+	data->stats.resets++;
+}
+
+static void uc8151_emul_busy_expired(struct k_timer *timer)
+{
+	struct uc8151_emul_data *data = &uc8151_emul_data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+	data->busy_on = false;
+	data->stats.busy_ms += k_uptime_get_32() - data->busy_start;
+	if (data->sleep_after_busy) {
+		data->sleep_after_busy = false;
+		uc8151_emul_sleep(data);
+	}
+
+	k_spin_unlock(&data->lock, key);
+
+	gpio_emul_input_set(data->busy, UC8151_EMUL_BUSY_PIN, 1);
+}
+
+static void uc8151_emul_pin_poll(struct k_timer *timer)
+{
+	struct uc8151_emul_data *data = &uc8151_emul_data;
+	k_spinlock_key_t key;
+	bool released = false;
+	bool reset;
+
+	if (!data->busy_driven) {
+		data->busy_driven = gpio_emul_input_set(data->busy,
+							UC8151_EMUL_BUSY_PIN,
+							1) == 0;
+	}
+
+	reset = gpio_emul_output_get(data->reset, UC8151_EMUL_RESET_PIN) == 0;
+
+	key = k_spin_lock(&data->lock);
+	if (reset && !data->in_reset) {
+		released = data->busy_on;
+		uc8151_emul_reset(data);
+	}
+
+	data->in_reset = reset;
+	k_spin_unlock(&data->lock, key);
+
+	if (released) {
+		gpio_emul_input_set(data->busy, UC8151_EMUL_BUSY_PIN, 1);
+	}
+}
+
+/* Window DTM1 and DTM2 data goes to */
+static bool uc8151_emul_data_window(struct uc8151_emul_data *data,
+				    struct uc8151_emul_window *win)
+{
+	if (!data->partial) {
+		win->x_start = 0U;
+		win->x_end = UC8151_EMUL_PITCH - 1U;
+		win->y_start = 0U;
+		win->y_end = UC8151_EMUL_HEIGHT - 1U;
+		return true;
+	}
+
+	if (!data->ptl_set) {
+		uc8151_emul_error(data, "partial mode without a window");
+		return false;
+	}
+
+	*win = data->ptl;
+
+	return true;
+}
+
+static bool uc8151_emul_can_refresh(struct uc8151_emul_data *data)
+{
+	struct uc8151_emul_window win;
+
+	if (!data->tres_set) {
+		uc8151_emul_error(data, "refresh without a resolution");
+		return false;
+	}
+
+	return uc8151_emul_data_window(data, &win);
+}
+
+/* Show the new frame, returns the time the refresh takes */
+static uint32_t uc8151_emul_refresh(struct uc8151_emul_data *data)
+{
+	size_t offset;
+
+	if (!data->partial) {
+		memcpy(data->panel, data->new_frame, sizeof(data->panel));
+		data->panel_known = true;
+		data->stats.full_refreshes++;
+		return CONFIG_UC8151_EMUL_FULL_REFRESH_MS;
+	}
+
+	for (uint16_t y = data->ptl.y_start; y <= data->ptl.y_end; y++) {
+		offset = y * UC8151_EMUL_PITCH + data->ptl.x_start;
+		memcpy(&data->panel[offset], &data->new_frame[offset],
+		       data->ptl.x_end - data->ptl.x_start + 1U);
+	}
+
+	data->stats.partial_refreshes++;
+
+	return CONFIG_UC8151_EMUL_PARTIAL_REFRESH_MS;
+}
+
+static void uc8151_emul_pixels(struct uc8151_emul_data *data, uint8_t value)
+{
+	struct uc8151_emul_window win;
+	size_t row_len;
+	size_t offset;
+	size_t row;
+
+	if (!uc8151_emul_data_window(data, &win)) {
+		return;
+	}
+
+	row_len = win.x_end - win.x_start + 1U;
+	row = data->count / row_len;
+	if (win.y_start + row > win.y_end) {
+		uc8151_emul_error(data, "more data than the window holds");
+		return;
+	}
+
+	offset = (win.y_start + row) * UC8151_EMUL_PITCH + win.x_start +
+		 data->count % row_len;
+
+	if (data->cmd == UC8151_CMD_DTM2) {
+		data->new_frame[offset] = value;
+		return;
+	}
+
+	/* A differential refresh needs the old data to match the panel */
+	if (data->panel_known && value != data->panel[offset]) {
+		uc8151_emul_error(data, "old data differs from the panel");
+	}
+
+	data->old_frame[offset] = value;
+}
+
+static void uc8151_emul_set_tres(struct uc8151_emul_data *data)
+{
+	uint16_t hres = sys_get_be16(&data->params[UC8151_TRES_HRES_IDX]);
+	uint16_t vres = sys_get_be16(&data->params[UC8151_TRES_VRES_IDX]);
+
+	if (hres != UC8151_EMUL_WIDTH || vres != UC8151_EMUL_HEIGHT) {
+		uc8151_emul_error(data, "resolution differs from the panel");
+		return;
+	}
+
+	data->tres_set = true;
+}
+
+static void uc8151_emul_set_ptl(struct uc8151_emul_data *data)
+{
+	uint16_t x_start = sys_get_be16(&data->params[UC8151_PTL_HRST_IDX]);
+	uint16_t x_end = sys_get_be16(&data->params[UC8151_PTL_HRED_IDX]);
+	uint16_t y_start = sys_get_be16(&data->params[UC8151_PTL_VRST_IDX]);
+	uint16_t y_end = sys_get_be16(&data->params[UC8151_PTL_VRED_IDX]);
+
+	data->ptl_set = false;
+
+	/* Horizontal borders are byte aligned */
+	if (x_start % 8U != 0U || x_end % 8U != 7U ||
+	    x_start > x_end || x_end >= UC8151_EMUL_WIDTH ||
+	    y_start > y_end || y_end >= UC8151_EMUL_HEIGHT) {
+		uc8151_emul_error(data, "invalid partial window");
+		return;
+	}
+
+	data->ptl.x_start = x_start / 8U;
+	data->ptl.x_end = x_end / 8U;
+	data->ptl.y_start = y_start;
+	data->ptl.y_end = y_end;
+	data->ptl_set = true;
+}
+
+static void uc8151_emul_auto(struct uc8151_emul_data *data, uint8_t seq)
+{
+	uint32_t ms = CONFIG_UC8151_EMUL_POWER_MS;
+
+	if (seq != UC8151_AUTO_PON_DRF_POF &&
+	    seq != UC8151_AUTO_PON_DRF_POF_DSLP) {
+		uc8151_emul_error(data, "unknown auto sequence");
+		return;
+	}
+
+	if (!uc8151_emul_can_refresh(data)) {
+		return;
+	}
+
+	if (!data->powered) {
+		ms += CONFIG_UC8151_EMUL_POWER_MS;
+	}
+
+	ms += uc8151_emul_refresh(data);
+	data->powered = false;
+	data->sleep_after_busy = seq == UC8151_AUTO_PON_DRF_POF_DSLP;
+	uc8151_emul_busy(data, ms);
+}
+
+static void uc8151_emul_command(struct uc8151_emul_data *data, uint8_t cmd)
+{
+	data->cmd = cmd;
+	data->count = 0U;
+	data->cmd_ignored = true;
+	data->cmd_failed = false;
+	data->stats.commands++;
+
+	if (data->in_reset) {
+		uc8151_emul_error(data, "sent during reset");
+		return;
+	}
+
+	if (data->asleep) {
+		uc8151_emul_error(data, "sent in deep sleep");
+		return;
+	}
+
+	/* Registers may change while BUSY, power and frame memory may not */
+	if (data->busy_on) {
+		switch (cmd) {
+		case UC8151_CMD_POF:
+		case UC8151_CMD_PON:
+		case UC8151_CMD_DSLP:
+		case UC8151_CMD_DTM1:
+		case UC8151_CMD_DRF:
+		case UC8151_CMD_DTM2:
+		case UC8151_CMD_AUTO:
+			uc8151_emul_error(data, "sent while BUSY");
+			return;
+		default:
+			break;
+		}
+	}
+
+	data->cmd_ignored = false;
+
+	switch (cmd) {
+	case UC8151_CMD_POF:
+		if (data->powered) {
+			data->powered = false;
+			uc8151_emul_busy(data, CONFIG_UC8151_EMUL_POWER_MS);
+		}
+		break;
+	case UC8151_CMD_PON:
+		if (!data->powered) {
+			data->powered = true;
+			uc8151_emul_busy(data, CONFIG_UC8151_EMUL_POWER_MS);
+		}
+		break;
+	case UC8151_CMD_DTM1:
+	case UC8151_CMD_DTM2:
+		if (!data->tres_set) {
+			uc8151_emul_error(data, "frame data without a resolution");
+		}
+		break;
+	case UC8151_CMD_DRF:
+		if (!data->powered) {
+			uc8151_emul_error(data, "refresh while powered off");
+		} else if (uc8151_emul_can_refresh(data)) {
+			uc8151_emul_busy(data, uc8151_emul_refresh(data));
+		}
+		break;
+	case UC8151_CMD_PTIN:
+		data->partial = true;
+		break;
+	case UC8151_CMD_PTOUT:
+		data->partial = false;
+		break;
+	default:
+		break;
+	}
+}
+
+static void uc8151_emul_param(struct uc8151_emul_data *data, uint8_t value)
+{
+	data->stats.payload_bytes++;
+
+	if (data->cmd == UC8151_EMUL_CMD_NONE) {
+		uc8151_emul_error(data, "data without a command");
+		return;
+	}
+
+	if (data->cmd_ignored) {
+		return;
+	}
+
+	switch (data->cmd) {
+	case UC8151_CMD_DTM1:
+	case UC8151_CMD_DTM2:
+		uc8151_emul_pixels(data, value);
+		break;
+	case UC8151_CMD_TRES:
+	case UC8151_CMD_PTL:
+		if (data->count < sizeof(data->params)) {
+			data->params[data->count] = value;
+		}
+
+		if (data->cmd == UC8151_CMD_TRES &&
+		    data->count == UC8151_TRES_REG_LENGTH - 1U) {
+			uc8151_emul_set_tres(data);
+		} else if (data->cmd == UC8151_CMD_PTL &&
+			   data->count == UC8151_PTL_REG_LENGTH - 1U) {
+			uc8151_emul_set_ptl(data);
+		}
+		break;
+	case UC8151_CMD_AUTO:
+		if (data->count == 0U) {
+			uc8151_emul_auto(data, value);
+		}
+		break;
+	case UC8151_CMD_DSLP:
+		if (data->count != 0U) {
+			break;
+		}
+
+		if (value != UC8151_DSLP_CHECK_CODE) {
+			uc8151_emul_error(data, "wrong check code");
+		} else if (data->powered) {
+			uc8151_emul_error(data, "deep sleep while powered on");
+		} else {
+			uc8151_emul_sleep(data);
+		}
+		break;
+	default:
+		break;
+	}
+
+	data->count++;
+}
+
+static int uc8151_emul_io(struct spi_emul *emul,
+			  const struct spi_config *config,
+			  const struct spi_buf_set *tx_bufs,
+			  const struct spi_buf_set *rx_bufs)
+{
+	struct uc8151_emul_data *data =
+		CONTAINER_OF(emul, struct uc8151_emul_data, spi);
+	bool cmd = gpio_emul_output_get(data->dc, UC8151_EMUL_DC_PIN) == 0;
+	bool was_busy;
+	const uint8_t *buf;
+	k_spinlock_key_t key;
+
+	ARG_UNUSED(config);
+	/* Nothing is read back over the 4-wire interface */
+	ARG_UNUSED(rx_bufs);
+
+	if (tx_bufs == NULL) {
+		return 0;
+	}
+
+	key = k_spin_lock(&data->lock);
+	was_busy = data->busy_on;
+	data->stats.transfers++;
+	if (cmd != data->dc_cmd) {
+		data->stats.dc_toggles++;
+		data->dc_cmd = cmd;
+	}
+
+	for (size_t i = 0; i < tx_bufs->count; i++) {
+		buf = tx_bufs->buffers[i].buf;
+		for (size_t j = 0; j < tx_bufs->buffers[i].len; j++) {
+			if (cmd) {
+				uc8151_emul_command(data, buf[j]);
+			} else {
+				uc8151_emul_param(data, buf[j]);
+			}
+		}
+	}
+
+	/* Asserting BUSY can't call the driver, it only waits for release */
+	if (data->busy_on && !was_busy) {
+		gpio_emul_input_set(data->busy, UC8151_EMUL_BUSY_PIN, 0);
+	}
+
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+static struct spi_emul_api uc8151_emul_api = {
+	.io = uc8151_emul_io,
+};
+
+static int uc8151_emul_release(const struct device *dev,
+			       const struct spi_config *config)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(config);
+
+	return 0;
+}
+
+void uc8151_emul_get_stats(struct uc8151_emul_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&uc8151_emul_data.lock);
+
+	*stats = uc8151_emul_data.stats;
+	k_spin_unlock(&uc8151_emul_data.lock, key);
+}
+
+void uc8151_emul_reset_stats(void)
+{
+	struct uc8151_emul_data *data = &uc8151_emul_data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+	memset(&data->stats, 0, sizeof(data->stats));
+	/* Only count the rest of a running BUSY period */
+	data->busy_start = k_uptime_get_32();
+	k_spin_unlock(&data->lock, key);
+}
+
+const uint8_t *uc8151_emul_get_panel(void)
+{
+	return uc8151_emul_data.panel;
+}
+
+static int uc8151_emul_init(const struct emul *emul,
+			    const struct device *parent)
+{
+	struct uc8151_emul_data *data = &uc8151_emul_data;
+	/* The API of the SPI emulator controller is not const in this tree */
+	struct spi_driver_api *bus_api = (struct spi_driver_api *)parent->api;
+
+	data->reset = device_get_binding(DT_INST_GPIO_LABEL(0, reset_gpios));
+	data->dc = device_get_binding(DT_INST_GPIO_LABEL(0, dc_gpios));
+	data->busy = device_get_binding(DT_INST_GPIO_LABEL(0, busy_gpios));
+	if (data->reset == NULL || data->dc == NULL || data->busy == NULL) {
+		LOG_ERR("Could not get the GPIO emulator ports");
+		return -ENODEV;
+	}
+
+	/*
+	 * The driver releases the bus after every locked session, which the
+	 * SPI emulator controller does not implement.
+	 */
+	if (bus_api->release == NULL) {
+		bus_api->release = uc8151_emul_release;
+	}
+
+	data->cmd = UC8151_EMUL_CMD_NONE;
+	k_timer_init(&data->busy_timer, uc8151_emul_busy_expired, NULL);
+	k_timer_init(&data->pin_timer, uc8151_emul_pin_poll, NULL);
+	k_timer_start(&data->pin_timer, K_MSEC(UC8151_EMUL_PIN_POLL_MS),
+		      K_MSEC(UC8151_EMUL_PIN_POLL_MS));
+
+	data->spi.api = &uc8151_emul_api;
+	data->spi.chipsel = DT_INST_REG_ADDR(0);
+
+	return spi_emul_register(parent, emul->dev_label, &data->spi);
+}
+
+EMUL_DEFINE(uc8151_emul_init, DT_DRV_INST(0), NULL)
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2020 PHYTEC Messtechnik GmbH
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_DRIVERS_DISPLAY_UC8151_EMUL_H_
+#define ZEPHYR_DRIVERS_DISPLAY_UC8151_EMUL_H_
+
+#include <zephyr/types.h>
+
+/** @brief What the emulated controller received and did */
+struct uc8151_emul_stats {
+	/** Command bytes received */
+	uint32_t commands;
+	/** Parameter and pixel bytes received */
+	uint32_t payload_bytes;
+	/** SPI transfers */
+	uint32_t transfers;
+	/** Changes of the DC line between transfers */
+	uint32_t dc_toggles;
+	/** Times BUSY was asserted */
+	uint32_t busy_periods;
+	/** Time BUSY was asserted */
+	uint32_t busy_ms;
+	/** Refreshes of the whole panel */
+	uint32_t full_refreshes;
+	/** Refreshes of a partial window */
+	uint32_t partial_refreshes;
+	/** Pulses seen on RESET */
+	uint32_t resets;
+	/** Protocol violations, each one is logged */
+	uint32_t errors;
+};
+
+/**
+ * @brief Get the counters of the emulated controller.
+ *
+ * Only available with CONFIG_UC8151_EMUL.
+ *
+ * @param stats Filled with the counters since the last reset
+ */
+void uc8151_emul_get_stats(struct uc8151_emul_stats *stats);
+
+/**
+ * @brief Reset the counters of the emulated controller.
+ *
+ * Only available with CONFIG_UC8151_EMUL.
+ */
+void uc8151_emul_reset_stats(void);
+
+/**
+ * @brief Get the image on the emulated panel.
+ *
+ * Rebuilt from the frame memory at every refresh, in the layout of the
+ * frame memory: rows of width / 8 bytes, MSB first, a set bit is white.
+ *
+ * Only available with CONFIG_UC8151_EMUL.
+ *
+ * @return Panel image, changes with the next refresh
+ */
+const uint8_t *uc8151_emul_get_panel(void);
+
+#endif /* ZEPHYR_DRIVERS_DISPLAY_UC8151_EMUL_H_ */
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 PHYTEC Messtechnik GmbH
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT gooddisplay_uc8151
+
+#include <stdlib.h>
+#include <string.h>
+#include <device.h>
+#include <drivers/display.h>
+#include <shell/shell.h>
+#include <sys/crc.h>
+
+#include "uc8151.h"
+
+#define UC8151_SHELL_WIDTH		DT_INST_PROP(0, width)
+#define UC8151_SHELL_HEIGHT		DT_INST_PROP(0, height)
+#define UC8151_SHELL_PITCH		(UC8151_SHELL_WIDTH / 8U)
+#define UC8151_SHELL_FB_SIZE		(UC8151_SHELL_PITCH * \
+					 UC8151_SHELL_HEIGHT)
+
+static const struct device *uc8151_dev = DEVICE_DT_INST_GET(0);
+
+static const char *const power_state_names[] = {
+	[UC8151_POWER_ACTIVE] = "active",
+	[UC8151_POWER_OFF] = "off",
+	[UC8151_POWER_DEEP_SLEEP] = "deep sleep",
+};
+
+static void print_stats(const struct shell *shell,
+			const struct uc8151_stats *stats)
+{
+	shell_print(shell, "  commands %u, payload %u B, transfers %u, "
+		    "dc toggles %u", stats->commands, stats->payload_bytes,
+		    stats->transfers, stats->dc_toggles);
+	shell_print(shell, "  busy waits %u (%u ms), refreshes %u (%u ms), "
+		    "resets %u", stats->busy_waits, stats->busy_wait_ms,
+		    stats->refreshes, stats->refresh_ms, stats->resets);
+}
+
+#ifdef CONFIG_UC8151_EMUL
+static void print_emul_stats(const struct shell *shell,
+			     const struct uc8151_emul_stats *stats)
+{
+	shell_print(shell, "  controller: commands %u, payload %u B, "
+		    "transfers %u, dc toggles %u", stats->commands,
+		    stats->payload_bytes, stats->transfers, stats->dc_toggles);
+	shell_print(shell, "  controller: busy %u (%u ms), refreshes %u full "
+		    "%u partial, resets %u, errors %u", stats->busy_periods,
+		    stats->busy_ms, stats->full_refreshes,
+		    stats->partial_refreshes, stats->resets, stats->errors);
+}
+#endif
+
+static int cmd_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	struct uc8151_power_stats power;
+	struct uc8151_stats stats;
+#ifdef CONFIG_UC8151_EMUL
+	struct uc8151_emul_stats emul;
+#endif
+
+	uc8151_get_stats(uc8151_dev, &stats);
+	uc8151_get_power_stats(uc8151_dev, &power);
+
+	shell_print(shell, "Interface:");
+	print_stats(shell, &stats);
+#ifdef CONFIG_UC8151_EMUL
+	uc8151_emul_get_stats(&emul);
+	print_emul_stats(shell, &emul);
+#endif
+	shell_print(shell, "Power: %s", power_state_names[power.state]);
+	for (int i = 0; i < UC8151_POWER_STATE_COUNT; i++) {
+		shell_print(shell, "  %s %llu ms", power_state_names[i],
+			    power.time_ms[i]);
+	}
+
+	shell_print(shell, "  wake ups %u, last %u ms, to pixels %u ms "
+		    "(max %u ms)", power.wakeups, power.last_wake_ms,
+		    power.last_wake_to_pixels_ms, power.max_wake_to_pixels_ms);
+
+	return 0;
+}
+
+static int cmd_reset(const struct shell *shell, size_t argc, char **argv)
+{
+	uc8151_reset_stats(uc8151_dev);
+#ifdef CONFIG_UC8151_EMUL
+	uc8151_emul_reset_stats();
+#endif
+
+	return 0;
+}
+
+static int cmd_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	struct uc8151_bench_result result;
+	int err;
+
+	err = display_blanking_off(uc8151_dev);
+	if (err) {
+		shell_error(shell, "Blanking off failed: %d", err);
+		return err;
+	}
+
+	for (int i = 0; i < UC8151_BENCH_STEP_COUNT; i++) {
+		err = uc8151_bench_run(uc8151_dev, i, &result);
+		if (err) {
+			shell_error(shell, "%s failed: %d",
+				    uc8151_bench_name(i), err);
+			return err;
+		}
+
+		shell_print(shell, "%s: %u ms", uc8151_bench_name(i),
+			    result.time_ms);
+		print_stats(shell, &result.stats);
+#ifdef CONFIG_UC8151_EMUL
+		print_emul_stats(shell, &result.emul);
+#endif
+	}
+
+	return 0;
+}
+
+/* Print rows of an image in frame memory layout, set bits are white */
+static int print_image(const struct shell *shell, const uint8_t *image,
+		       size_t argc, char **argv)
+{
+	char line[UC8151_SHELL_WIDTH + 1];
+	unsigned long first = 0;
+	unsigned long rows = UC8151_SHELL_HEIGHT;
+
+	if (argc > 1) {
+		first = strtoul(argv[1], NULL, 0);
+	}
+
+	if (argc > 2) {
+		rows = strtoul(argv[2], NULL, 0);
+	}
+
+	if (first >= UC8151_SHELL_HEIGHT) {
+		shell_error(shell, "Row out of range");
+		return -EINVAL;
+	}
+
+	rows = MIN(rows, UC8151_SHELL_HEIGHT - first);
+	for (unsigned long y = first; y < first + rows; y++) {
+		for (uint16_t x = 0; x < UC8151_SHELL_WIDTH; x++) {
+			line[x] = (image[y * UC8151_SHELL_PITCH + x / 8U] &
+				   BIT(7U - x % 8U)) ? '.' : '#';
+		}
+
+		line[UC8151_SHELL_WIDTH] = '\0';
+		shell_print(shell, "%3lu %s", y, line);
+	}
+
+	shell_print(shell, "crc32 0x%08x",
+		    crc32_ieee(image, UC8151_SHELL_FB_SIZE));
+
+	return 0;
+}
+
+static int cmd_dump(const struct shell *shell, size_t argc, char **argv)
+{
+	return print_image(shell, display_get_framebuffer(uc8151_dev),
+			   argc, argv);
+}
+
+#ifdef CONFIG_UC8151_EMUL
+static int cmd_panel(const struct shell *shell, size_t argc, char **argv)
+{
+	const uint8_t *panel = uc8151_emul_get_panel();
+	int err;
+
+	err = uc8151_wait_idle(uc8151_dev);
+	if (err) {
+		shell_error(shell, "Waiting for the refresh failed: %d", err);
+		return err;
+	}
+
+	err = print_image(shell, panel, argc, argv);
+	if (err) {
+		return err;
+	}
+
+	if (memcmp(panel, display_get_framebuffer(uc8151_dev),
+		   UC8151_SHELL_FB_SIZE)) {
+		shell_warn(shell, "Panel differs from the framebuffer");
+	} else {
+		shell_print(shell, "Panel matches the framebuffer");
+	}
+
+	return 0;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_uc8151,
+	SHELL_CMD(stats, NULL, "Show interface and power statistics",
+		  cmd_stats),
+	SHELL_CMD(reset, NULL, "Reset interface statistics", cmd_reset),
+	SHELL_CMD(bench, NULL, "Measure init, clear, full and partial updates",
+		  cmd_bench),
+	SHELL_CMD_ARG(dump, NULL, "Print the shadow framebuffer "
+		      "[first row] [rows]", cmd_dump, 1, 2),
+	SHELL_COND_CMD_ARG(CONFIG_UC8151_EMUL, panel, NULL,
+			   "Print the image on the emulated panel "
+			   "[first row] [rows]", cmd_panel, 1, 2),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(uc8151, &sub_uc8151, "UC8151 display controller", NULL);
@@ -1,137 +1,264 @@
 #include "bme280.h"
+#if CONFIG_SUBSYS_BME280_ASYNC
+#include "bme280_forced.h"
+#endif
+#include "sensor_bus.h"
+#if CONFIG_SUBSYS_SENSOR_FILTER
+#include "sensor_filter.h"
+#endif
+#if CONFIG_SUBSYS_SENSOR_I2C
+#include "sensor_i2c.h"
+#endif
+#include "sensor_sched.h"
 
 #include <zephyr.h>
+#include <init.h>
 #include <logging/log.h>
 
 LOG_MODULE_REGISTER(bme280);
 
-static void bme280_entry_point(void *, void *, void *);
-
-K_THREAD_DEFINE(sensor_bme280, CONFIG_SUBSYS_BME280_STACK_SIZE,
-                bme280_entry_point, NULL, NULL, NULL,
-                CONFIG_SUBSYS_BME280_THREAD_PRIORITY, 0, 0);
-
-#define REGISTER_PUBLISHABLE_SENSOR_VALUE(name, max_count)               \
-    static bme280_value_cb name##_callbacks[max_count];                   \
-    static int num_##name##_callbacks_registered = 0;                    \
-    K_MUTEX_DEFINE(bme280_##name##_callback_mutex);                       \
-                                                                         \
-    void bme280_register_##name##_handler(bme280_value_cb cb)              \
-    {                                                                    \
-        bool success = true;                                             \
-                                                                         \
-        k_mutex_lock(&bme280_##name##_callback_mutex, K_FOREVER);         \
-                                                                         \
-        if (num_##name##_callbacks_registered < max_count)               \
-        {                                                                \
-            name##_callbacks[num_##name##_callbacks_registered] = cb;    \
-            num_##name##_callbacks_registered++;                         \
-        }                                                                \
-        else                                                             \
-        {                                                                \
-            success = false;                                             \
-        }                                                                \
-                                                                         \
-        k_mutex_unlock(&bme280_##name##_callback_mutex);                  \
-                                                                         \
-        if (!success)                                                    \
-        {                                                                \
-            LOG_ERR("Unable to register " STRINGIFY(name) " callback!"); \
-        }                                                                \
-    }                                                                    \
-                                                                         \
-    static void publish_##name##_value(struct sensor_value value)        \
-    {                                                                    \
-        k_mutex_lock(&bme280_##name##_callback_mutex, K_FOREVER);         \
-        for (int i = 0; i < num_##name##_callbacks_registered; i++)      \
-        {                                                                \
-            name##_callbacks[i](value);                                  \
-        }                                                                \
-        k_mutex_unlock(&bme280_##name##_callback_mutex);                  \
-    }
+#define BME280_NODE DT_INST(0, bosch_bme280)
+
+// Steps of 0.01 hPa per kPa
+#define PRESSURE_SCALE 1000
 
-REGISTER_PUBLISHABLE_SENSOR_VALUE(temperature, CONFIG_SUBSYS_BME280_CALLBACK_MAX_COUNT_TEMPERATURE);
-REGISTER_PUBLISHABLE_SENSOR_VALUE(humidity, CONFIG_SUBSYS_BME280_CALLBACK_MAX_COUNT_HUMIDITY);
-REGISTER_PUBLISHABLE_SENSOR_VALUE(pressure, CONFIG_SUBSYS_BME280_CALLBACK_MAX_COUNT_PRESSURE);
+BUILD_ASSERT(101 * PRESSURE_SCALE + 325000 / (1000000 / PRESSURE_SCALE) == 101325,
+             "101.325 kPa must be 101325 in 0.01 hPa");
 
 int bme280_fail_counter = 0;
 
-static void bme280_entry_point(void *u1, void *u2, void *u3)
+static const struct device *bme280;
+
+static const struct
 {
-    // Initialize BME280 Temp+Humidity sensor
-    const struct device *bme280 = device_get_binding("BME280");
-    if (!bme280)
-    {
-        LOG_ERR("Failed to find sensor %s!", "BME280");
-        return;
-    }
+    enum sensor_bus_channel bus;
+    enum sensor_channel sensor;
+    // Fixed point steps per sensor unit
+    int32_t scale;
+} channels[] = {
+    {SENSOR_BUS_TEMPERATURE, SENSOR_CHAN_AMBIENT_TEMP, 100},
+    {SENSOR_BUS_HUMIDITY, SENSOR_CHAN_HUMIDITY, 100},
+    // Sensor reports kPa
+    {SENSOR_BUS_PRESSURE, SENSOR_CHAN_PRESS, PRESSURE_SCALE},
+};
 
-    struct sensor_value temperature;
-    struct sensor_value humidity;
-    struct sensor_value pressure;
+#if CONFIG_SUBSYS_BME280_ASYNC
+static uint32_t bme280_trigger(void);
+#endif
+static void bme280_sample(void);
 
-    while (1)
-    {
-        k_sleep(K_MSEC(CONFIG_SUBSYS_BME280_SAMPLING_RATE_MS));
+static struct sensor_sched_task bme280_task = {
+    .name = "bme280",
+#if CONFIG_SUBSYS_BME280_ADAPTIVE_SAMPLING
+    .period_ms = MIN(CONFIG_SUBSYS_BME280_TEMPERATURE_MIN_INTERVAL_MS,
+                     MIN(CONFIG_SUBSYS_BME280_HUMIDITY_MIN_INTERVAL_MS,
+                         CONFIG_SUBSYS_BME280_PRESSURE_MIN_INTERVAL_MS)),
+#else
+    .period_ms = CONFIG_SUBSYS_BME280_SAMPLING_RATE_MS,
+#endif
+#if CONFIG_SUBSYS_BME280_ASYNC
+    .trigger = bme280_trigger,
+#endif
+    .sample = bme280_sample,
+    .bus = DEVICE_DT_GET(DT_BUS(BME280_NODE)),
+};
 
-        int success;
+#if CONFIG_SUBSYS_SENSOR_I2C
+BUILD_ASSERT(DT_ON_BUS(BME280_NODE, i2c), "BME280 recovery needs I2C");
 
-        success = sensor_sample_fetch(bme280);
+static struct sensor_i2c_device bme280_i2c = {
+    .name = "bme280",
+    .bus = DEVICE_DT_GET(DT_BUS(BME280_NODE)),
+#if CONFIG_SUBSYS_BME280_ASYNC
+    // Also tells whether the sensor is back
+    .reinit = bme280_forced_init,
+#endif
+};
+#endif
 
-        if (success != 0)
-        {
-            LOG_WRN("Sensor fetch failed: %d", success);
-
-            // If we fail too many times in a row, publish that we are
-            // now in an error state.
-            // Don't publish it right away, because sporadic fails seem to happen
-            // regularly.
-            bme280_fail_counter += 1;
-            if (bme280_fail_counter >= CONFIG_SUBSYS_BME280_MAX_FETCH_ATTEMPTS)
-            {
-                publish_temperature_value(BME280_ERROR_VALUE);
-                publish_humidity_value(BME280_ERROR_VALUE);
-                publish_pressure_value(BME280_ERROR_VALUE);
-            }
+#if CONFIG_SUBSYS_BME280_ADAPTIVE_SAMPLING
+// Same order as channels
+static struct sensor_sched_adaptive adaptive[] = {
+    SENSOR_SCHED_ADAPTIVE_INITIALIZER(CONFIG_SUBSYS_BME280_TEMPERATURE_MIN_INTERVAL_MS,
+                                      CONFIG_SUBSYS_BME280_TEMPERATURE_MAX_INTERVAL_MS,
+                                      CONFIG_SUBSYS_BME280_TEMPERATURE_BAND),
+    SENSOR_SCHED_ADAPTIVE_INITIALIZER(CONFIG_SUBSYS_BME280_HUMIDITY_MIN_INTERVAL_MS,
+                                      CONFIG_SUBSYS_BME280_HUMIDITY_MAX_INTERVAL_MS,
+                                      CONFIG_SUBSYS_BME280_HUMIDITY_BAND),
+    SENSOR_SCHED_ADAPTIVE_INITIALIZER(CONFIG_SUBSYS_BME280_PRESSURE_MIN_INTERVAL_MS,
+                                      CONFIG_SUBSYS_BME280_PRESSURE_MAX_INTERVAL_MS,
+                                      CONFIG_SUBSYS_BME280_PRESSURE_BAND),
+};
 
-            continue;
-        }
-        bme280_fail_counter = 0;
+BUILD_ASSERT(ARRAY_SIZE(adaptive) == ARRAY_SIZE(channels),
+             "One adaptive interval per channel");
+#endif
 
-        success = sensor_channel_get(bme280, SENSOR_CHAN_AMBIENT_TEMP,
-                                     &temperature);
-        if (success != 0)
+// Sample again at the shortest interval any channel wants
+static void adapt_period(const struct sensor_bus_record *record)
+{
+#if CONFIG_SUBSYS_BME280_ADAPTIVE_SAMPLING
+    uint32_t period = UINT32_MAX;
+    enum sensor_bus_channel bus;
+    uint32_t interval;
+
+    for (int i = 0; i < ARRAY_SIZE(channels); i++)
+    {
+        bus = channels[i].bus;
+        if (sensor_bus_record_valid(record, bus))
         {
-            LOG_WRN("get failed: %d", success);
-            publish_temperature_value(BME280_ERROR_VALUE);
+            interval = sensor_sched_adapt(&adaptive[i], record->values[bus]);
         }
         else
         {
-            publish_temperature_value(temperature);
+            interval = sensor_sched_adapt_reset(&adaptive[i]);
         }
 
-        success = sensor_channel_get(bme280, SENSOR_CHAN_HUMIDITY,
-                                     &humidity);
-        if (success != 0)
-        {
-            LOG_WRN("get failed: %d", success);
-            publish_humidity_value(BME280_ERROR_VALUE);
-        }
-        else
+        period = MIN(period, interval);
+    }
+
+    sensor_sched_set_period(&bme280_task, period);
+#endif
+}
+
+#if CONFIG_SUBSYS_BME280_ASYNC
+static int64_t trigger_time;
+static int trigger_err;
+
+static uint32_t bme280_trigger(void)
+{
+    int ret;
+
+    trigger_time = k_uptime_get();
+    ret = bme280_forced_trigger();
+    trigger_err = MIN(ret, 0);
+
+    // Read out the failure right away
+    return MAX(ret, 0);
+}
+
+static int bme280_fetch(struct sensor_bus_record *record)
+{
+    int ret;
+
+    // Convert in place when the trigger failed, so a retry does not
+    // wait for the next period
+    if (trigger_err != 0)
+    {
+        trigger_time = k_uptime_get();
+        ret = bme280_forced_trigger();
+        trigger_err = MIN(ret, 0);
+        if (trigger_err != 0)
         {
-            publish_humidity_value(humidity);
+            return trigger_err;
         }
 
-        success = sensor_channel_get(bme280, SENSOR_CHAN_PRESS,
-                                     &pressure);
+        k_msleep(ret);
+    }
+
+    record->timestamp = trigger_time;
+    return bme280_forced_read(record);
+}
+#else
+static int bme280_fetch(struct sensor_bus_record *record)
+{
+    struct sensor_value value;
+    int success;
+
+    record->timestamp = k_uptime_get();
+    success = sensor_sample_fetch(bme280);
+    if (success != 0)
+    {
+        return success;
+    }
+
+    // All channels come from the same measurement
+    for (int i = 0; i < ARRAY_SIZE(channels); i++)
+    {
+        success = sensor_channel_get(bme280, channels[i].sensor, &value);
         if (success != 0)
         {
             LOG_WRN("get failed: %d", success);
-            publish_pressure_value(BME280_ERROR_VALUE);
+            record->status[channels[i].bus] = SENSOR_BUS_STATUS_READ_FAILED;
+            continue;
         }
-        else
+
+        record->values[channels[i].bus] = sensor_bus_fixed(&value,
+                                                           channels[i].scale);
+    }
+
+    return 0;
+}
+#endif
+
+static void bme280_sample(void)
+{
+    struct sensor_bus_record record = {
+        .channels = BME280_CHANNELS,
+    };
+    int success;
+
+#if CONFIG_SUBSYS_SENSOR_I2C
+    success = sensor_i2c_fetch(&bme280_i2c, bme280_fetch, &record);
+#else
+    success = bme280_fetch(&record);
+#endif
+
+    if (success != 0)
+    {
+        LOG_WRN("Sensor fetch failed: %d", success);
+
+        // If we fail too many times in a row, publish that we are
+        // now in an error state.
+        // Don't publish it right away, because sporadic fails seem to happen
+        // regularly.
+        bme280_fail_counter += 1;
+        sensor_bus_record_fail(&record, SENSOR_BUS_STATUS_FETCH_FAILED);
+        adapt_period(&record);
+        if (bme280_fail_counter >= CONFIG_SUBSYS_BME280_MAX_FETCH_ATTEMPTS)
         {
-            publish_pressure_value(pressure);
+            sensor_bus_publish(&record);
         }
+
+        return;
     }
+    bme280_fail_counter = 0;
+
+    adapt_period(&record);
+#if CONFIG_SUBSYS_SENSOR_FILTER
+    sensor_filter_apply(&record);
+#endif
+    sensor_bus_publish(&record);
 }
+
+static int bme280_subsys_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    // Initialize BME280 Temp+Humidity sensor
+    bme280 = device_get_binding("BME280");
+    if (!bme280)
+    {
+        LOG_ERR("Failed to find sensor %s!", "BME280");
+        return -ENODEV;
+    }
+
+#if CONFIG_SUBSYS_BME280_ASYNC
+    // The driver has configured the sensor, take over the conversions
+    int err = bme280_forced_init();
+    if (err != 0)
+    {
+        LOG_ERR("Failed to read calibration: %d", err);
+        return err;
+    }
+#endif
+
+#if CONFIG_SUBSYS_SENSOR_I2C
+    sensor_i2c_register(&bme280_i2c);
+#endif
+    sensor_sched_register(&bme280_task);
+
+    return 0;
+}
+
+SYS_INIT(bme280_subsys_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
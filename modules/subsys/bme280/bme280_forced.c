@@ -0,0 +1,278 @@
+#include "bme280_forced.h"
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/i2c.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+
+LOG_MODULE_DECLARE(bme280);
+
+#define BME280_NODE DT_INST(0, bosch_bme280)
+
+#define REG_CALIB_00 0x88
+#define REG_CALIB_26 0xe1
+#define REG_CTRL_HUM 0xf2
+#define REG_STATUS 0xf3
+#define REG_CTRL_MEAS 0xf4
+
+#define STATUS_MEASURING BIT(3)
+#define CTRL_MEAS_MODE_MASK 0x03
+#define CTRL_MEAS_MODE_SLEEP 0x00
+#define CTRL_MEAS_MODE_FORCED 0x01
+
+// Reading 0xf3 to 0xfe: status, ctrl_meas, config, reserved, then
+// pressure, temperature and humidity, MSB first
+#define BURST_LEN 12
+#define BURST_DATA 4
+
+// ADC value of a channel that was skipped
+#define ADC_SKIPPED_20 0x80000
+#define ADC_SKIPPED_16 0x8000
+
+// Oversampling setting codes, as chosen for the Zephyr driver
+#if CONFIG_BME280_TEMP_OVER_1X
+#define OSRS_T 1
+#elif CONFIG_BME280_TEMP_OVER_2X
+#define OSRS_T 2
+#elif CONFIG_BME280_TEMP_OVER_4X
+#define OSRS_T 3
+#elif CONFIG_BME280_TEMP_OVER_8X
+#define OSRS_T 4
+#else
+#define OSRS_T 5
+#endif
+
+#if CONFIG_BME280_PRESS_OVER_1X
+#define OSRS_P 1
+#elif CONFIG_BME280_PRESS_OVER_2X
+#define OSRS_P 2
+#elif CONFIG_BME280_PRESS_OVER_4X
+#define OSRS_P 3
+#elif CONFIG_BME280_PRESS_OVER_8X
+#define OSRS_P 4
+#else
+#define OSRS_P 5
+#endif
+
+#if CONFIG_BME280_HUMIDITY_OVER_1X
+#define OSRS_H 1
+#elif CONFIG_BME280_HUMIDITY_OVER_2X
+#define OSRS_H 2
+#elif CONFIG_BME280_HUMIDITY_OVER_4X
+#define OSRS_H 3
+#elif CONFIG_BME280_HUMIDITY_OVER_8X
+#define OSRS_H 4
+#else
+#define OSRS_H 5
+#endif
+
+#define OVERSAMPLING(osrs) (1 << ((osrs) - 1))
+
+// Datasheet 9.1, maximum measurement time in us
+#define CONVERSION_US (1250 + 2300 * OVERSAMPLING(OSRS_T) +    \
+                       2300 * OVERSAMPLING(OSRS_P) + 575 +      \
+                       2300 * OVERSAMPLING(OSRS_H) + 575)
+
+struct calibration
+{
+    uint16_t t1;
+    int16_t t2;
+    int16_t t3;
+    uint16_t p1;
+    int16_t p2;
+    int16_t p3;
+    int16_t p4;
+    int16_t p5;
+    int16_t p6;
+    int16_t p7;
+    int16_t p8;
+    int16_t p9;
+    uint8_t h1;
+    int16_t h2;
+    uint8_t h3;
+    int16_t h4;
+    int16_t h5;
+    int8_t h6;
+};
+
+static const struct i2c_dt_spec bus = I2C_DT_SPEC_GET(BME280_NODE);
+static struct calibration calib;
+
+int bme280_forced_init(void)
+{
+    uint8_t buf[26];
+    int err;
+
+    if (!device_is_ready(bus.bus))
+    {
+        return -ENODEV;
+    }
+
+    err = i2c_burst_read_dt(&bus, REG_CALIB_00, buf, sizeof(buf));
+    if (err != 0)
+    {
+        return err;
+    }
+
+    calib.t1 = sys_get_le16(&buf[0]);
+    calib.t2 = sys_get_le16(&buf[2]);
+    calib.t3 = sys_get_le16(&buf[4]);
+    calib.p1 = sys_get_le16(&buf[6]);
+    calib.p2 = sys_get_le16(&buf[8]);
+    calib.p3 = sys_get_le16(&buf[10]);
+    calib.p4 = sys_get_le16(&buf[12]);
+    calib.p5 = sys_get_le16(&buf[14]);
+    calib.p6 = sys_get_le16(&buf[16]);
+    calib.p7 = sys_get_le16(&buf[18]);
+    calib.p8 = sys_get_le16(&buf[20]);
+    calib.p9 = sys_get_le16(&buf[22]);
+    calib.h1 = buf[25];
+
+    err = i2c_burst_read_dt(&bus, REG_CALIB_26, buf, 7);
+    if (err != 0)
+    {
+        return err;
+    }
+
+    calib.h2 = sys_get_le16(&buf[0]);
+    calib.h3 = buf[2];
+    // 12 bit values sharing the nibbles of 0xe5
+    calib.h4 = (int16_t)((int8_t)buf[3] * 16) | (buf[4] & 0x0f);
+    calib.h5 = (int16_t)((int8_t)buf[5] * 16) | (buf[4] >> 4);
+    calib.h6 = buf[6];
+
+    return 0;
+}
+
+int bme280_forced_trigger(void)
+{
+    // Humidity settings only apply with the following ctrl_meas write
+    const uint8_t cmd[] = {
+        REG_CTRL_HUM, OSRS_H,
+        REG_CTRL_MEAS, (OSRS_T << 5) | (OSRS_P << 2) | CTRL_MEAS_MODE_FORCED,
+    };
+    int err;
+
+    err = i2c_write_dt(&bus, cmd, sizeof(cmd));
+    if (err != 0)
+    {
+        return err;
+    }
+
+    return DIV_ROUND_UP(CONVERSION_US, 1000);
+}
+
+// Datasheet 4.2.3, 0.01 Celsius
+static int32_t compensate_temperature(int32_t adc, int32_t *t_fine)
+{
+    int32_t var1;
+    int32_t var2;
+
+    var1 = (((adc >> 3) - ((int32_t)calib.t1 << 1)) * calib.t2) >> 11;
+    var2 = (((((adc >> 4) - calib.t1) * ((adc >> 4) - calib.t1)) >> 12) *
+            calib.t3) >> 14;
+    *t_fine = var1 + var2;
+
+    return (*t_fine * 5 + 128) >> 8;
+}
+
+// Q24.8 Pa
+static uint32_t compensate_pressure(int32_t adc, int32_t t_fine)
+{
+    int64_t var1;
+    int64_t var2;
+    int64_t p;
+
+    var1 = (int64_t)t_fine - 128000;
+    var2 = var1 * var1 * calib.p6;
+    var2 = var2 + ((var1 * calib.p5) << 17);
+    var2 = var2 + ((int64_t)calib.p4 << 35);
+    var1 = ((var1 * var1 * calib.p3) >> 8) + ((var1 * calib.p2) << 12);
+    var1 = ((((int64_t)1 << 47) + var1) * calib.p1) >> 33;
+    if (var1 == 0)
+    {
+        return 0;
+    }
+
+    p = 1048576 - adc;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = ((int64_t)calib.p9 * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((int64_t)calib.p8 * p) >> 19;
+
+    return ((p + var1 + var2) >> 8) + ((int64_t)calib.p7 << 4);
+}
+
+// Q22.10 %RH
+static uint32_t compensate_humidity(int32_t adc, int32_t t_fine)
+{
+    int32_t h = t_fine - 76800;
+
+    h = (((adc << 14) - ((int32_t)calib.h4 << 20) - (calib.h5 * h) + 16384) >> 15) *
+        (((((((h * calib.h6) >> 10) * (((h * calib.h3) >> 11) + 32768)) >> 10) +
+           2097152) * calib.h2 + 8192) >> 14);
+    h = h - (((((h >> 15) * (h >> 15)) >> 7) * calib.h1) >> 4);
+    h = CLAMP(h, 0, 419430400);
+
+    return h >> 12;
+}
+
+int bme280_forced_read(struct sensor_bus_record *record)
+{
+    uint8_t buf[BURST_LEN];
+    const uint8_t *data = &buf[BURST_DATA];
+    int32_t adc_p;
+    int32_t adc_t;
+    int32_t adc_h;
+    int32_t t_fine;
+    int err;
+
+    err = i2c_burst_read_dt(&bus, REG_STATUS, buf, sizeof(buf));
+    if (err != 0)
+    {
+        return err;
+    }
+
+    // Back in sleep mode once the conversion is done
+    if ((buf[0] & STATUS_MEASURING) ||
+        (buf[1] & CTRL_MEAS_MODE_MASK) != CTRL_MEAS_MODE_SLEEP)
+    {
+        LOG_WRN("Conversion not finished");
+        return -EAGAIN;
+    }
+
+    adc_p = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+    adc_t = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+    adc_h = sys_get_be16(&data[6]);
+    if (adc_t == ADC_SKIPPED_20)
+    {
+        return -EIO;
+    }
+
+    // Pressure and humidity are compensated with the temperature
+    record->values[SENSOR_BUS_TEMPERATURE] =
+        compensate_temperature(adc_t, &t_fine);
+
+    if (adc_p == ADC_SKIPPED_20)
+    {
+        record->status[SENSOR_BUS_PRESSURE] = SENSOR_BUS_STATUS_READ_FAILED;
+    }
+    else
+    {
+        // 0.01 hPa is 1 Pa
+        record->values[SENSOR_BUS_PRESSURE] =
+            (compensate_pressure(adc_p, t_fine) + 128) >> 8;
+    }
+
+    if (adc_h == ADC_SKIPPED_16)
+    {
+        record->status[SENSOR_BUS_HUMIDITY] = SENSOR_BUS_STATUS_READ_FAILED;
+    }
+    else
+    {
+        record->values[SENSOR_BUS_HUMIDITY] =
+            (compensate_humidity(adc_h, t_fine) * 100 + 512) >> 10;
+    }
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+// Read the calibration of the sensor. Its driver must have configured it.
+int bme280_forced_init(void);
+
+// Start one forced mode conversion. Returns the worst case conversion time
+// in ms from the datasheet, or a negative errno.
+int bme280_forced_trigger(void);
+
+// Read the result of the conversion in one burst and store the compensated
+// values in record
+int bme280_forced_read(struct sensor_bus_record *record);
@@ -0,0 +1,120 @@
+#include "eink_gfx.h"
+
+#include <zephyr.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+#include <string.h>
+
+#include "eink_font.inc"
+
+#define PIXELS_PER_WORD 32U
+
+// Ink or clear the pixels of bits, MSB first, within one canvas word
+static inline void put_word(uint32_t *word, uint32_t bits, bool set)
+{
+    uint32_t mask = sys_cpu_to_be32(bits);
+
+    if (set)
+    {
+        *word |= mask;
+    }
+    else
+    {
+        *word &= ~mask;
+    }
+}
+
+// Ink or clear up to 32 pixels, MSB first, starting at pixel x of a row
+static inline void put_bits(uint32_t *row, uint16_t x, uint32_t bits, bool set)
+{
+    uint32_t *word = &row[x / PIXELS_PER_WORD];
+    uint8_t shift = x % PIXELS_PER_WORD;
+
+    put_word(word, bits >> shift, set);
+    if (shift != 0U && (bits << (PIXELS_PER_WORD - shift)) != 0U)
+    {
+        put_word(word + 1, bits << (PIXELS_PER_WORD - shift), set);
+    }
+}
+
+static inline uint32_t *canvas_row(const struct eink_gfx_canvas *canvas,
+                                   uint16_t y)
+{
+    return (uint32_t *)(canvas->buf + y * canvas->pitch);
+}
+
+void eink_gfx_fill_rect(const struct eink_gfx_canvas *canvas,
+                        uint16_t x, uint16_t y,
+                        uint16_t width, uint16_t height, bool ink)
+{
+    bool set = ink == (canvas->ink != 0U);
+    uint16_t x_end;
+    uint16_t y_end;
+    uint16_t count;
+    uint32_t *row;
+
+    __ASSERT(IS_PTR_ALIGNED(canvas->buf, uint32_t), "Canvas not aligned");
+    __ASSERT(!(canvas->pitch % sizeof(uint32_t)), "Pitch not word aligned");
+
+    if (x >= canvas->width || y >= canvas->height)
+    {
+        return;
+    }
+
+    x_end = MIN(x + width, canvas->width);
+    y_end = MIN(y + height, canvas->height);
+
+    for (; y < y_end; y++)
+    {
+        row = canvas_row(canvas, y);
+        // Each chunk stays within one word
+        for (uint16_t px = x; px < x_end; px += count)
+        {
+            count = MIN(PIXELS_PER_WORD - px % PIXELS_PER_WORD, x_end - px);
+            put_bits(row, px, UINT32_MAX << (PIXELS_PER_WORD - count), set);
+        }
+    }
+}
+
+uint16_t eink_gfx_text_width(const struct eink_gfx_font *font,
+                             const char *text)
+{
+    return strlen(text) * font->advance;
+}
+
+uint16_t eink_gfx_draw_text(const struct eink_gfx_canvas *canvas,
+                            const struct eink_gfx_font *font,
+                            uint16_t x, uint16_t y, const char *text)
+{
+    bool set = canvas->ink != 0U;
+    uint16_t rows = MIN(font->height, canvas->height - MIN(y, canvas->height));
+    const uint16_t *glyph;
+    uint32_t clip;
+    uint8_t c;
+
+    __ASSERT(IS_PTR_ALIGNED(canvas->buf, uint32_t), "Canvas not aligned");
+    __ASSERT(!(canvas->pitch % sizeof(uint32_t)), "Pitch not word aligned");
+
+    for (; *text != '\0' && x < canvas->width; text++, x += font->advance)
+    {
+        c = *text;
+        if (c < font->first || c > font->last)
+        {
+            c = '?';
+        }
+
+        glyph = &font->rows[(c - font->first) * font->height];
+
+        // Glyph rows sit in the upper half word, clip at the right edge
+        clip = UINT32_MAX << (PIXELS_PER_WORD -
+                              MIN(font->width, canvas->width - x));
+
+        for (uint16_t r = 0; r < rows; r++)
+        {
+            put_bits(canvas_row(canvas, y + r), x,
+                     ((uint32_t)glyph[r] << 16) & clip, set);
+        }
+    }
+
+    return x;
+}
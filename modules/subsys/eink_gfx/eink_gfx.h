@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Degree sign, stored in place of DEL in the font */
+#define EINK_GFX_DEGREE "\x7f"
+
+/**
+ * 1bpp drawing surface, leftmost pixel in the most significant bit.
+ * buf must be word aligned and pitch a multiple of 4 bytes.
+ */
+struct eink_gfx_canvas
+{
+    uint8_t *buf;
+    uint16_t width;
+    uint16_t height;
+    uint16_t pitch;
+    // Bit value of an inked pixel
+    uint8_t ink;
+};
+
+/** Monospaced font atlas, one uint16_t per glyph row, MSB first */
+struct eink_gfx_font
+{
+    uint8_t width;
+    uint8_t height;
+    uint8_t advance;
+    uint8_t first;
+    uint8_t last;
+    const uint16_t *rows;
+};
+
+// 5x7 font scaled 1x, 2x and 3x, generated at build time
+extern const struct eink_gfx_font eink_gfx_font_x1;
+extern const struct eink_gfx_font eink_gfx_font_x2;
+extern const struct eink_gfx_font eink_gfx_font_x3;
+
+void eink_gfx_fill_rect(const struct eink_gfx_canvas *canvas,
+                        uint16_t x, uint16_t y,
+                        uint16_t width, uint16_t height, bool ink);
+
+uint16_t eink_gfx_text_width(const struct eink_gfx_font *font,
+                             const char *text);
+
+/**
+ * Draw text with its top left corner at x, y. Only glyph pixels are
+ * touched, characters outside of the font are drawn as '?'.
+ *
+ * @return x coordinate following the last glyph
+ */
+uint16_t eink_gfx_draw_text(const struct eink_gfx_canvas *canvas,
+                            const struct eink_gfx_font *font,
+                            uint16_t x, uint16_t y, const char *text);
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Convert a text font description into scaled 1bpp glyph atlases.
+
+Every glyph row is emitted as a uint16_t with the leftmost pixel in the
+most significant bit, so the blitter can shift a whole row into place.
+"""
+
+import argparse
+import sys
+
+
+def parse_font(path):
+    width = height = None
+    glyphs = {}
+    code = None
+    rows = []
+
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#') and code is None:
+                continue
+
+            fields = line.split()
+            if fields[0] == 'width':
+                width = int(fields[1])
+            elif fields[0] == 'height':
+                height = int(fields[1])
+            elif fields[0] == 'char':
+                code = int(fields[1], 0)
+                rows = []
+            else:
+                if code is None:
+                    sys.exit(f'{path}:{lineno}: row outside of a glyph')
+                if len(line) != width:
+                    sys.exit(f'{path}:{lineno}: expected {width} pixels')
+                rows.append(line)
+                if len(rows) == height:
+                    glyphs[code] = rows
+                    code = None
+
+    return width, height, glyphs
+
+
+def scale_glyph(rows, scale):
+    out = []
+    for row in rows:
+        bits = 0
+        for pixel in row:
+            for _ in range(scale):
+                bits = (bits << 1) | (pixel == '#')
+        for _ in range(scale):
+            out.append(bits)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--input', required=True)
+    parser.add_argument('--output', required=True)
+    parser.add_argument('--scales', type=int, nargs='+', default=[1])
+    args = parser.parse_args()
+
+    width, height, glyphs = parse_font(args.input)
+    first = min(glyphs)
+    last = max(glyphs)
+    missing = [c for c in range(first, last + 1) if c not in glyphs]
+    if missing:
+        sys.exit(f'{args.input}: missing glyphs {missing}')
+
+    lines = [f'/* Generated by gen_font.py from {args.input.split("/")[-1]}, '
+             'do not edit. */', '']
+    for scale in args.scales:
+        glyph_width = width * scale
+        if glyph_width > 16:
+            sys.exit(f'scale {scale} makes glyphs wider than 16 pixels')
+
+        name = f'eink_gfx_font_x{scale}'
+        lines.append(f'static const uint16_t {name}_rows[] = {{')
+        for code in range(first, last + 1):
+            rows = scale_glyph(glyphs[code], scale)
+            shifted = [r << (16 - glyph_width) for r in rows]
+            lines.append(f'\t/* 0x{code:02x} */')
+            for i in range(0, len(shifted), 8):
+                chunk = ', '.join(f'0x{r:04x}' for r in shifted[i:i + 8])
+                lines.append(f'\t{chunk},')
+        lines.append('};')
+        lines.append('')
+        lines.append(f'const struct eink_gfx_font {name} = {{')
+        lines.append(f'\t.width = {glyph_width},')
+        lines.append(f'\t.height = {height * scale},')
+        lines.append(f'\t.advance = {(width + 1) * scale},')
+        lines.append(f'\t.first = 0x{first:02x},')
+        lines.append(f'\t.last = 0x{last:02x},')
+        lines.append(f'\t.rows = {name}_rows,')
+        lines.append('};')
+        lines.append('')
+
+    with open(args.output, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,313 @@
+#include "eink_ui.h"
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/display.h>
+#include <logging/log.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/atomic.h>
+
+#include "eink_gfx.h"
+#include "sensor_bus.h"
+#include "uc8151.h"
+
+LOG_MODULE_REGISTER(eink_ui);
+
+#define MARGIN 1U
+#define FIELD_HEIGHT 70U
+#define LABEL_OFFSET 4U
+#define VALUE_OFFSET 16U
+
+#define LABEL_FONT eink_gfx_font_x1
+#define VALUE_FONT eink_gfx_font_x3
+#define UNIT_FONT eink_gfx_font_x1
+
+enum field_id
+{
+#if CONFIG_SUBSYS_BME280
+    FIELD_TEMPERATURE,
+    FIELD_HUMIDITY,
+    FIELD_PRESSURE,
+#endif
+#if CONFIG_SUBSYS_MAX44009
+    FIELD_LUMINOSITY,
+#endif
+    FIELD_COUNT
+};
+
+struct field
+{
+    const char *label;
+    const char *unit;
+    enum sensor_bus_channel channel;
+    // Minimum change before a redraw, in hundredths of the unit
+    int32_t delta;
+    uint8_t decimals;
+    // Value on the panel
+    int32_t shown;
+    bool shown_valid;
+    bool drawn;
+    // Latest value received from the sensor
+    int32_t latest;
+    bool latest_valid;
+};
+
+static struct field fields[] = {
+#if CONFIG_SUBSYS_BME280
+    [FIELD_TEMPERATURE] = {
+        .label = "TEMPERATURE",
+        .channel = SENSOR_BUS_TEMPERATURE,
+        .unit = EINK_GFX_DEGREE "C",
+        .delta = CONFIG_SUBSYS_EINK_UI_TEMPERATURE_DELTA,
+        .decimals = 1,
+    },
+    [FIELD_HUMIDITY] = {
+        .label = "HUMIDITY",
+        .channel = SENSOR_BUS_HUMIDITY,
+        .unit = "%",
+        .delta = CONFIG_SUBSYS_EINK_UI_HUMIDITY_DELTA,
+        .decimals = 0,
+    },
+    [FIELD_PRESSURE] = {
+        .label = "PRESSURE",
+        .channel = SENSOR_BUS_PRESSURE,
+        .unit = "hPa",
+        .delta = CONFIG_SUBSYS_EINK_UI_PRESSURE_DELTA,
+        .decimals = 1,
+    },
+#endif
+#if CONFIG_SUBSYS_MAX44009
+    [FIELD_LUMINOSITY] = {
+        .label = "LIGHT",
+        .channel = SENSOR_BUS_LUMINOSITY,
+        .unit = "lx",
+        .delta = CONFIG_SUBSYS_EINK_UI_LUMINOSITY_DELTA,
+        .decimals = 0,
+    },
+#endif
+};
+
+static struct k_spinlock fields_lock;
+
+#define DISPLAY_NODE DT_CHOSEN(zephyr_display)
+
+// Partial windows and asynchronous refreshes are UC8151 extensions
+BUILD_ASSERT(DT_NODE_HAS_COMPAT(DISPLAY_NODE, gooddisplay_uc8151),
+             "zephyr,display must be a gooddisplay,uc8151 controller");
+
+static const struct device *display = DEVICE_DT_GET(DISPLAY_NODE);
+static struct eink_gfx_canvas canvas;
+
+static void update_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(update_work, update_work_handler);
+
+// Partial updates since the last full refresh
+static int partial_updates = 0;
+static atomic_t refresh_busy;
+
+static bool is_significant(const struct field *field)
+{
+    if (!field->drawn || field->latest_valid != field->shown_valid)
+    {
+        return true;
+    }
+
+    return field->latest_valid &&
+           abs(field->latest - field->shown) >= field->delta;
+}
+
+static void format_value(char *buf, size_t len, int32_t centi, uint8_t decimals)
+{
+    int32_t div = decimals ? 10 : 100;
+    int32_t value = (centi + (centi < 0 ? -div / 2 : div / 2)) / div;
+
+    if (decimals == 0)
+    {
+        snprintk(buf, len, "%d", value);
+    }
+    else
+    {
+        snprintk(buf, len, "%s%d.%d", value < 0 ? "-" : "",
+                 abs(value) / 10, abs(value) % 10);
+    }
+}
+
+static void draw_value(enum field_id id, int32_t value, bool valid)
+{
+    const struct field *field = &fields[id];
+    uint16_t y = id * FIELD_HEIGHT + VALUE_OFFSET;
+    char text[12];
+    uint16_t x;
+
+    if (valid)
+    {
+        format_value(text, sizeof(text), value, field->decimals);
+    }
+    else
+    {
+        strcpy(text, "--");
+    }
+
+    eink_gfx_fill_rect(&canvas, 0, y, canvas.width, VALUE_FONT.height, false);
+    x = eink_gfx_draw_text(&canvas, &VALUE_FONT, MARGIN, y, text);
+    eink_gfx_draw_text(&canvas, &UNIT_FONT, x,
+                       y + VALUE_FONT.height - UNIT_FONT.height, field->unit);
+
+    uc8151_invalidate(display, 0, y, canvas.width, VALUE_FONT.height);
+}
+
+static void refresh_done(const struct device *dev, int status, void *user_data)
+{
+    if (status != 0)
+    {
+        LOG_ERR("Panel refresh failed (err: %d)", status);
+    }
+
+    atomic_clear(&refresh_busy);
+}
+
+static void refresh(bool full)
+{
+    int err;
+
+    if (full)
+    {
+        // Refresh the whole panel once the dirty windows are loaded
+        display_blanking_on(display);
+    }
+
+#if CONFIG_UC8151_BUSY_INTERRUPT
+    atomic_set(&refresh_busy, 1);
+    err = uc8151_refresh_async(display, refresh_done, NULL);
+    if (err != 0)
+    {
+        atomic_clear(&refresh_busy);
+    }
+#else
+    err = full ? display_blanking_off(display) : uc8151_flush(display);
+#endif
+
+    if (err != 0)
+    {
+        LOG_ERR("Panel refresh failed (err: %d)", err);
+    }
+}
+
+static void update_work_handler(struct k_work *work)
+{
+    int32_t values[FIELD_COUNT];
+    bool valid[FIELD_COUNT];
+    bool changed[FIELD_COUNT];
+    bool any_changed = false;
+    bool full = false;
+    k_spinlock_key_t key;
+
+    // Never draw into the frame while it is being pushed out
+    if (atomic_get(&refresh_busy))
+    {
+        k_work_schedule(&update_work, K_MSEC(CONFIG_SUBSYS_EINK_UI_COALESCE_MS));
+        return;
+    }
+
+    key = k_spin_lock(&fields_lock);
+    for (int i = 0; i < FIELD_COUNT; i++)
+    {
+        changed[i] = is_significant(&fields[i]);
+        if (changed[i])
+        {
+            fields[i].shown = fields[i].latest;
+            fields[i].shown_valid = fields[i].latest_valid;
+            fields[i].drawn = true;
+            any_changed = true;
+        }
+        values[i] = fields[i].shown;
+        valid[i] = fields[i].shown_valid;
+    }
+    k_spin_unlock(&fields_lock, key);
+
+    if (!any_changed)
+    {
+        return;
+    }
+
+    for (int i = 0; i < FIELD_COUNT; i++)
+    {
+        if (changed[i])
+        {
+            draw_value(i, values[i], valid[i]);
+        }
+    }
+
+    // The budget of partials is spent, this update clears the ghosting
+    if (partial_updates >= CONFIG_SUBSYS_EINK_UI_FULL_REFRESH_INTERVAL)
+    {
+        partial_updates = 0;
+        full = true;
+    }
+    else
+    {
+        partial_updates++;
+    }
+
+    refresh(full);
+}
+
+void eink_ui_show_record(const struct sensor_bus_record *record)
+{
+    struct field *field;
+    bool significant = false;
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&fields_lock);
+    for (int i = 0; i < FIELD_COUNT; i++)
+    {
+        field = &fields[i];
+        if (!sensor_bus_record_has(record, field->channel))
+        {
+            continue;
+        }
+
+        field->latest_valid = sensor_bus_record_valid(record, field->channel);
+        field->latest = field->latest_valid ? record->values[field->channel] : 0;
+        significant |= is_significant(field);
+    }
+    k_spin_unlock(&fields_lock, key);
+
+    // Changes arriving until the work runs are drawn in the same update
+    if (significant)
+    {
+        k_work_schedule(&update_work, K_MSEC(CONFIG_SUBSYS_EINK_UI_COALESCE_MS));
+    }
+}
+
+int eink_ui_init(void)
+{
+    if (!device_is_ready(display))
+    {
+        LOG_ERR("Display not ready");
+        return -ENODEV;
+    }
+
+    // The framebuffer stays in panel orientation whatever the display
+    // orientation, so the capabilities would swap the axes under rotation
+    canvas.buf = display_get_framebuffer(display);
+    canvas.width = DT_PROP(DISPLAY_NODE, width);
+    canvas.height = DT_PROP(DISPLAY_NODE, height);
+    canvas.pitch = DT_PROP(DISPLAY_NODE, width) / 8U;
+    // The driver clears the panel to 0xff, ink is the other level
+    canvas.ink = 0U;
+
+    for (int i = 0; i < FIELD_COUNT; i++)
+    {
+        eink_gfx_draw_text(&canvas, &LABEL_FONT, MARGIN,
+                           i * FIELD_HEIGHT + LABEL_OFFSET, fields[i].label);
+        uc8151_invalidate(display, 0, i * FIELD_HEIGHT + LABEL_OFFSET,
+                          canvas.width, LABEL_FONT.height);
+        draw_value(i, 0, false);
+    }
+
+    refresh(true);
+
+    return 0;
+}
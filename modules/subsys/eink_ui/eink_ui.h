@@ -0,0 +1,7 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+int eink_ui_init(void);
+
+void eink_ui_show_record(const struct sensor_bus_record *record);
@@ -1,115 +1,192 @@
 #include "max44009.h"
+#if CONFIG_SUBSYS_MAX44009_INTERRUPT
+#include "max44009_int.h"
+#endif
+#include "sensor_bus.h"
+#if CONFIG_SUBSYS_SENSOR_FILTER
+#include "sensor_filter.h"
+#endif
+#if CONFIG_SUBSYS_SENSOR_I2C
+#include "sensor_i2c.h"
+#endif
+#include "sensor_sched.h"
 
 #include <zephyr.h>
+#include <init.h>
 #include <logging/log.h>
 
 LOG_MODULE_REGISTER(max44009);
 
-static void max44009_entry_point(void *, void *, void *);
-
-K_THREAD_DEFINE(sensor_max44009, CONFIG_SUBSYS_MAX44009_STACK_SIZE,
-                max44009_entry_point, NULL, NULL, NULL,
-                CONFIG_SUBSYS_MAX44009_THREAD_PRIORITY, 0, 0);
-
-#define REGISTER_PUBLISHABLE_SENSOR_VALUE(name, max_count)               \
-    static max44009_value_cb name##_callbacks[max_count];                   \
-    static int num_##name##_callbacks_registered = 0;                    \
-    K_MUTEX_DEFINE(max44009_##name##_callback_mutex);                       \
-                                                                         \
-    void max44009_register_##name##_handler(max44009_value_cb cb)              \
-    {                                                                    \
-        bool success = true;                                             \
-                                                                         \
-        k_mutex_lock(&max44009_##name##_callback_mutex, K_FOREVER);         \
-                                                                         \
-        if (num_##name##_callbacks_registered < max_count)               \
-        {                                                                \
-            name##_callbacks[num_##name##_callbacks_registered] = cb;    \
-            num_##name##_callbacks_registered++;                         \
-        }                                                                \
-        else                                                             \
-        {                                                                \
-            success = false;                                             \
-        }                                                                \
-                                                                         \
-        k_mutex_unlock(&max44009_##name##_callback_mutex);                  \
-                                                                         \
-        if (!success)                                                    \
-        {                                                                \
-            LOG_ERR("Unable to register " STRINGIFY(name) " callback!"); \
-        }                                                                \
-    }                                                                    \
-                                                                         \
-    static void publish_##name##_value(struct sensor_value value)        \
-    {                                                                    \
-        k_mutex_lock(&max44009_##name##_callback_mutex, K_FOREVER);         \
-        for (int i = 0; i < num_##name##_callbacks_registered; i++)      \
-        {                                                                \
-            name##_callbacks[i](value);                                  \
-        }                                                                \
-        k_mutex_unlock(&max44009_##name##_callback_mutex);                  \
-    }
-
-REGISTER_PUBLISHABLE_SENSOR_VALUE(luminosity, CONFIG_SUBSYS_MAX44009_CALLBACK_MAX_COUNT_AMBIENT_LIGHT);
+#define MAX44009_NODE DT_INST(0, maxim_max44009)
 
 int max44009_fail_counter = 0;
 
-static void max44009_entry_point(void *u1, void *u2, void *u3)
+static const struct device *max44009;
+
+static void max44009_sample(void);
+
+static struct sensor_sched_task max44009_task = {
+    .name = "max44009",
+#if CONFIG_SUBSYS_MAX44009_INTERRUPT
+    .period_ms = CONFIG_SUBSYS_MAX44009_WATCHDOG_MS,
+#elif CONFIG_SUBSYS_MAX44009_ADAPTIVE_SAMPLING
+    .period_ms = CONFIG_SUBSYS_MAX44009_LUMINOSITY_MIN_INTERVAL_MS,
+#else
+    .period_ms = CONFIG_SUBSYS_MAX44009_SAMPLING_RATE_MS,
+#endif
+    .sample = max44009_sample,
+    .bus = DEVICE_DT_GET(DT_BUS(MAX44009_NODE)),
+};
+
+#if CONFIG_SUBSYS_SENSOR_I2C
+static struct sensor_i2c_device max44009_i2c = {
+    .name = "max44009",
+    .bus = DEVICE_DT_GET(DT_BUS(MAX44009_NODE)),
+#if CONFIG_SUBSYS_MAX44009_INTERRUPT
+    // The next reading arms the thresholds again
+    .reinit = max44009_int_configure,
+#endif
+};
+#endif
+
+#if CONFIG_SUBSYS_MAX44009_ADAPTIVE_SAMPLING
+static struct sensor_sched_adaptive adaptive =
+    SENSOR_SCHED_ADAPTIVE_INITIALIZER(CONFIG_SUBSYS_MAX44009_LUMINOSITY_MIN_INTERVAL_MS,
+                                      CONFIG_SUBSYS_MAX44009_LUMINOSITY_MAX_INTERVAL_MS,
+                                      CONFIG_SUBSYS_MAX44009_LUMINOSITY_BAND);
+#endif
+
+static void adapt_period(const struct sensor_bus_record *record)
 {
-    // Initialize MAX44009 luminosity sensor
-    const struct device *max44009 = device_get_binding("MAX44009");
-    if (!max44009)
+#if CONFIG_SUBSYS_MAX44009_ADAPTIVE_SAMPLING
+    uint32_t period;
+
+    if (sensor_bus_record_valid(record, SENSOR_BUS_LUMINOSITY))
     {
-        LOG_ERR("Failed to find sensor %s!", "MAX44009");
-        return;
+        period = sensor_sched_adapt(&adaptive,
+                                    record->values[SENSOR_BUS_LUMINOSITY]);
+    }
+    else
+    {
+        period = sensor_sched_adapt_reset(&adaptive);
     }
 
-    struct sensor_value luminosity;
+    sensor_sched_set_period(&max44009_task, period);
+#endif
+}
 
-    while (1)
-    {
-        k_sleep(K_MSEC(CONFIG_SUBSYS_MAX44009_SAMPLING_RATE_MS));
+#if CONFIG_SUBSYS_MAX44009_INTERRUPT
+// Runs in the INT pin interrupt
+static void light_changed(void)
+{
+    sensor_sched_request(&max44009_task);
+}
+#endif
 
-        int success;
+// Wait for the light to leave a window around the reading
+static void arm_window(const struct sensor_bus_record *record)
+{
+#if CONFIG_SUBSYS_MAX44009_INTERRUPT
+    int err = max44009_int_arm(record->values[SENSOR_BUS_LUMINOSITY]);
 
-        success = sensor_sample_fetch(max44009);
+    // The watchdog poll tries again
+    if (err != 0)
+    {
+        LOG_WRN("Failed to set thresholds: %d", err);
+    }
+#endif
+}
 
-        if (success != 0)
-        {
-            LOG_WRN("Sensor fetch failed: %d", success);
-
-            // If we fail too many times in a row, publish that we are
-            // now in an error state.
-            // Don't publish it right away, because sporadic fails seem to happen
-            // regularly.
-            max44009_fail_counter += 1;
-            if (max44009_fail_counter >= CONFIG_SUBSYS_MAX44009_MAX_FETCH_ATTEMPTS)
-            {
-                publish_luminosity_value(MAX44009_ERROR_VALUE);
-            }
-
-            continue;
-        }
-        max44009_fail_counter = 0;
-        
-        success = sensor_sample_fetch_chan(max44009,SENSOR_CHAN_LIGHT);
-        if (success != 0)
-        {
-            LOG_WRN("get failed: %d", success);
-            publish_luminosity_value(MAX44009_ERROR_VALUE);
-        }
+static int max44009_fetch(struct sensor_bus_record *record)
+{
+    record->timestamp = k_uptime_get();
+    return sensor_sample_fetch(max44009);
+}
 
-        success = sensor_channel_get(max44009, SENSOR_CHAN_LIGHT,
-                                     &luminosity);
-        if (success != 0)
-        {
-            LOG_WRN("get failed: %d", success);
-            publish_luminosity_value(MAX44009_ERROR_VALUE);
-        }
-        else
+static void max44009_sample(void)
+{
+    struct sensor_bus_record record = {
+        .channels = MAX44009_CHANNELS,
+    };
+    struct sensor_value value;
+    int success;
+
+#if CONFIG_SUBSYS_SENSOR_I2C
+    success = sensor_i2c_fetch(&max44009_i2c, max44009_fetch, &record);
+#else
+    success = max44009_fetch(&record);
+#endif
+
+    if (success != 0)
+    {
+        LOG_WRN("Sensor fetch failed: %d", success);
+
+        // If we fail too many times in a row, publish that we are
+        // now in an error state.
+        // Don't publish it right away, because sporadic fails seem to happen
+        // regularly.
+        max44009_fail_counter += 1;
+        sensor_bus_record_fail(&record, SENSOR_BUS_STATUS_FETCH_FAILED);
+        adapt_period(&record);
+        if (max44009_fail_counter >= CONFIG_SUBSYS_MAX44009_MAX_FETCH_ATTEMPTS)
         {
-            publish_luminosity_value(luminosity);
+            sensor_bus_publish(&record);
         }
 
+        return;
     }
+    max44009_fail_counter = 0;
+
+    // The fetch above read the light channel already
+    success = sensor_channel_get(max44009, SENSOR_CHAN_LIGHT, &value);
+    if (success != 0)
+    {
+        LOG_WRN("get failed: %d", success);
+        sensor_bus_record_fail(&record, SENSOR_BUS_STATUS_READ_FAILED);
+    }
+    else
+    {
+        record.values[SENSOR_BUS_LUMINOSITY] = sensor_bus_fixed(&value, 100);
+        arm_window(&record);
+    }
+
+    adapt_period(&record);
+#if CONFIG_SUBSYS_SENSOR_FILTER
+    sensor_filter_apply(&record);
+#endif
+    sensor_bus_publish(&record);
 }
+
+static int max44009_subsys_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    // Initialize MAX44009 luminosity sensor
+    max44009 = device_get_binding("MAX44009");
+    if (!max44009)
+    {
+        LOG_ERR("Failed to find sensor %s!", "MAX44009");
+        return -ENODEV;
+    }
+
+#if CONFIG_SUBSYS_SENSOR_I2C
+    sensor_i2c_register(&max44009_i2c);
+#endif
+    sensor_sched_register(&max44009_task);
+
+#if CONFIG_SUBSYS_MAX44009_INTERRUPT
+    int err = max44009_int_init(light_changed);
+    if (err != 0)
+    {
+        LOG_ERR("Failed to set up the interrupt: %d", err);
+        return err;
+    }
+
+    // The first reading opens the threshold window
+    sensor_sched_request(&max44009_task);
+#endif
+
+    return 0;
+}
+
+SYS_INIT(max44009_subsys_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
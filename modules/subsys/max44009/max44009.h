@@ -1,9 +1,6 @@
 #pragma once
 
-#include <drivers/sensor.h>
+#include "sensor_bus.h"
 
-typedef void (*max44009_value_cb)(struct sensor_value value);
-
-void max44009_register_luminosity_handler(max44009_value_cb cb);
-
-static const struct sensor_value MAX44009_ERROR_VALUE = {.val1 = 0, .val2 = -1};
+// Channels of the records published by the MAX44009 subsystem
+#define MAX44009_CHANNELS SENSOR_BUS_CHANNEL_BIT(SENSOR_BUS_LUMINOSITY)
@@ -0,0 +1,147 @@
+#include "max44009_int.h"
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/gpio.h>
+#include <drivers/i2c.h>
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(max44009);
+
+#define MAX44009_NODE DT_INST(0, maxim_max44009)
+
+#define REG_INT_STATUS 0x00
+#define REG_INT_ENABLE 0x01
+#define REG_THRESH_UPPER 0x05
+#define REG_THRESH_LOWER 0x06
+#define REG_THRESH_TIMER 0x07
+
+#define INT_ENABLE BIT(0)
+
+// Threshold bytes hold a 4 bit exponent and the top 4 bits of the 8 bit
+// mantissa. The upper threshold extends the mantissa with ones, the lower
+// one with zeros.
+#define THRESH_EXPONENT_MAX 14
+#define THRESH_MANTISSA_FILL 0x0f
+
+BUILD_ASSERT(DT_NODE_HAS_PROP(MAX44009_NODE, int_gpios),
+             "MAX44009 node needs int-gpios");
+
+static const struct i2c_dt_spec bus = I2C_DT_SPEC_GET(MAX44009_NODE);
+static const struct gpio_dt_spec int_gpio = GPIO_DT_SPEC_GET(MAX44009_NODE,
+                                                             int_gpios);
+static struct gpio_callback int_cb;
+static void (*int_handler)(void);
+
+// The pin stays asserted until the status is read, so the level
+// interrupt is masked here and unmasked by max44009_int_arm()
+static void int_callback(const struct device *port, struct gpio_callback *cb,
+                         gpio_port_pins_t pins)
+{
+    gpio_pin_interrupt_configure_dt(&int_gpio, GPIO_INT_DISABLE);
+    int_handler();
+}
+
+// Threshold byte for a level in sensor steps of 0.045 lx, the nearest
+// one outside the level
+static uint8_t encode_threshold(uint64_t level, bool upper)
+{
+    uint8_t exponent = 0;
+
+    // Keep 8 mantissa bits, rounding away from the reading
+    while (level > 0xff)
+    {
+        level = upper ? (level + 1) >> 1 : level >> 1;
+        exponent++;
+    }
+
+    if (exponent > THRESH_EXPONENT_MAX)
+    {
+        return (THRESH_EXPONENT_MAX << 4) | THRESH_MANTISSA_FILL;
+    }
+
+    // The fill bits already round the upper threshold up
+    return (exponent << 4) | (level >> 4);
+}
+
+int max44009_int_configure(void)
+{
+    uint8_t status;
+    int err;
+
+    // Reading the status releases the pin
+    err = i2c_reg_write_byte_dt(&bus, REG_INT_ENABLE, 0);
+    if (err == 0)
+    {
+        err = i2c_reg_read_byte_dt(&bus, REG_INT_STATUS, &status);
+    }
+    if (err == 0)
+    {
+        err = i2c_reg_write_byte_dt(&bus, REG_THRESH_TIMER,
+                                    CONFIG_SUBSYS_MAX44009_THRESHOLD_TIMER_MS / 100);
+    }
+
+    return err;
+}
+
+int max44009_int_init(void (*handler)(void))
+{
+    int err;
+
+    if (!device_is_ready(bus.bus) || !device_is_ready(int_gpio.port))
+    {
+        return -ENODEV;
+    }
+
+    int_handler = handler;
+
+    err = max44009_int_configure();
+    if (err != 0)
+    {
+        return err;
+    }
+
+    err = gpio_pin_configure_dt(&int_gpio, GPIO_INPUT);
+    if (err != 0)
+    {
+        return err;
+    }
+
+    gpio_init_callback(&int_cb, int_callback, BIT(int_gpio.pin));
+    // The first max44009_int_arm() enables the interrupt
+    return gpio_add_callback(int_gpio.port, &int_cb);
+}
+
+int max44009_int_arm(int32_t lux)
+{
+    // One sensor step is 4.5 in 0.01 lx
+    uint64_t level = (uint64_t)MAX(lux, 0) * 2 / 9;
+    uint8_t upper = encode_threshold(
+        level * (100 + CONFIG_SUBSYS_MAX44009_THRESHOLD_PERCENT) / 100, true);
+    uint8_t lower = encode_threshold(
+        level * (100 - CONFIG_SUBSYS_MAX44009_THRESHOLD_PERCENT) / 100, false);
+    uint8_t status;
+    int err;
+
+    // A change during the write triggers again once enabled
+    err = i2c_reg_read_byte_dt(&bus, REG_INT_STATUS, &status);
+    if (err == 0)
+    {
+        err = i2c_reg_write_byte_dt(&bus, REG_THRESH_UPPER, upper);
+    }
+    if (err == 0)
+    {
+        err = i2c_reg_write_byte_dt(&bus, REG_THRESH_LOWER, lower);
+    }
+    if (err == 0)
+    {
+        err = i2c_reg_write_byte_dt(&bus, REG_INT_ENABLE, INT_ENABLE);
+    }
+    if (err == 0)
+    {
+        // Level triggered, an interrupt raised meanwhile is not lost
+        err = gpio_pin_interrupt_configure_dt(&int_gpio, GPIO_INT_LEVEL_ACTIVE);
+    }
+
+    return err;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+// Configure the INT pin and the threshold timer. handler runs in the
+// interrupt once the illuminance left the window for the timer duration.
+int max44009_int_init(void (*handler)(void));
+
+// Disable the interrupt and set the threshold timer. Also sets the sensor
+// up again after it lost its registers.
+int max44009_int_configure(void);
+
+// Clear a pending interrupt, open the threshold window around lux, in
+// 0.01 lx, and enable the interrupt. The handler runs at most once per arm.
+int max44009_int_arm(int32_t lux);
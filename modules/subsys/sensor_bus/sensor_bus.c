@@ -0,0 +1,165 @@
+#include "sensor_bus.h"
+
+#include <zephyr.h>
+#include <init.h>
+#include <logging/log.h>
+#include <sys/atomic.h>
+
+LOG_MODULE_REGISTER(sensor_bus);
+
+#define RING_SIZE CONFIG_SUBSYS_SENSOR_BUS_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0 && RING_SIZE >= 2,
+             "Ring size must be a power of two");
+
+struct subscriber
+{
+    struct k_work work;
+    struct k_work_q *queue;
+    sensor_bus_handler_t handler;
+    uint8_t channels;
+    // Next record to read, only touched by the subscriber work
+    uint32_t tail;
+};
+
+static struct sensor_bus_record ring[RING_SIZE];
+// Number of records ever published, slot index is head & RING_MASK
+static atomic_t head;
+static atomic_t dropped;
+
+static struct subscriber subscribers[CONFIG_SUBSYS_SENSOR_BUS_MAX_SUBSCRIBERS];
+// Subscribers visible to the publisher, written after the entry is complete
+static atomic_t num_subscribers;
+static struct k_spinlock subscribe_lock;
+
+#if CONFIG_ASSERT
+static k_tid_t publisher;
+#endif
+
+K_THREAD_STACK_DEFINE(sensor_bus_stack, CONFIG_SUBSYS_SENSOR_BUS_STACK_SIZE);
+static struct k_work_q sensor_bus_queue;
+
+static void subscriber_work_handler(struct k_work *work)
+{
+    struct subscriber *sub = CONTAINER_OF(work, struct subscriber, work);
+    struct sensor_bus_record record;
+    uint32_t published;
+    uint32_t lost;
+
+    while (true)
+    {
+        published = atomic_get(&head);
+        if (published == sub->tail)
+        {
+            break;
+        }
+
+        // The publisher writes slot head before publishing it, so only
+        // RING_SIZE - 1 published records are safe to read
+        if (published - sub->tail >= RING_SIZE)
+        {
+            lost = published - sub->tail - (RING_SIZE - 1);
+            sub->tail += lost;
+            atomic_add(&dropped, lost);
+            LOG_WRN("Subscriber %p lost %u records", sub->handler, lost);
+        }
+
+        compiler_barrier();
+        record = ring[sub->tail & RING_MASK];
+        compiler_barrier();
+
+        // Lapped while copying, the slot may be torn
+        if ((uint32_t)atomic_get(&head) - sub->tail >= RING_SIZE)
+        {
+            continue;
+        }
+
+        sub->tail++;
+        if (record.channels & sub->channels)
+        {
+            sub->handler(&record);
+        }
+    }
+}
+
+int sensor_bus_subscribe(uint8_t channels, sensor_bus_handler_t handler,
+                         struct k_work_q *queue)
+{
+    struct subscriber *sub;
+    k_spinlock_key_t key;
+    int err = 0;
+
+    if ((channels & SENSOR_BUS_ALL_CHANNELS) == 0 || handler == NULL)
+    {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&subscribe_lock);
+
+    if (atomic_get(&num_subscribers) == ARRAY_SIZE(subscribers))
+    {
+        err = -ENOMEM;
+    }
+    else
+    {
+        sub = &subscribers[atomic_get(&num_subscribers)];
+        k_work_init(&sub->work, subscriber_work_handler);
+        sub->queue = queue ? queue : &sensor_bus_queue;
+        sub->handler = handler;
+        sub->channels = channels;
+        sub->tail = atomic_get(&head);
+        atomic_inc(&num_subscribers);
+    }
+
+    k_spin_unlock(&subscribe_lock, key);
+
+    return err;
+}
+
+void sensor_bus_publish(const struct sensor_bus_record *record)
+{
+    uint32_t published = atomic_get(&head);
+    int count;
+
+#if CONFIG_ASSERT
+    if (publisher == NULL)
+    {
+        publisher = k_current_get();
+    }
+    __ASSERT(publisher == k_current_get(), "Records from several threads");
+#endif
+
+    ring[published & RING_MASK] = *record;
+    compiler_barrier();
+    atomic_set(&head, published + 1);
+
+    count = atomic_get(&num_subscribers);
+    for (int i = 0; i < count; i++)
+    {
+        if (subscribers[i].channels & record->channels)
+        {
+            k_work_submit_to_queue(subscribers[i].queue,
+                                   &subscribers[i].work);
+        }
+    }
+}
+
+uint32_t sensor_bus_dropped(void)
+{
+    return atomic_get(&dropped);
+}
+
+static int sensor_bus_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    k_work_queue_start(&sensor_bus_queue, sensor_bus_stack,
+                       K_THREAD_STACK_SIZEOF(sensor_bus_stack),
+                       CONFIG_SUBSYS_SENSOR_BUS_THREAD_PRIORITY, NULL);
+    k_thread_name_set(&sensor_bus_queue.thread, "sensor_bus");
+
+    return 0;
+}
+
+SYS_INIT(sensor_bus_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <kernel.h>
+#include <drivers/sensor.h>
+
+enum sensor_bus_channel
+{
+    SENSOR_BUS_TEMPERATURE,
+    SENSOR_BUS_HUMIDITY,
+    SENSOR_BUS_PRESSURE,
+    SENSOR_BUS_LUMINOSITY,
+    SENSOR_BUS_CHANNEL_COUNT
+};
+
+#define SENSOR_BUS_CHANNEL_BIT(channel) BIT(channel)
+#define SENSOR_BUS_ALL_CHANNELS BIT_MASK(SENSOR_BUS_CHANNEL_COUNT)
+
+enum sensor_bus_status
+{
+    SENSOR_BUS_STATUS_OK,
+    // The sensor did not deliver a sample
+    SENSOR_BUS_STATUS_FETCH_FAILED,
+    // The sample was taken, but the channel could not be read from it
+    SENSOR_BUS_STATUS_READ_FAILED,
+};
+
+// All channels of one sample, taken at the same time
+struct sensor_bus_record
+{
+    // Uptime of the sample in ms
+    int64_t timestamp;
+    // Channels present in the record
+    uint8_t channels;
+    // enum sensor_bus_status of each present channel
+    uint8_t status[SENSOR_BUS_CHANNEL_COUNT];
+    // In 0.01 Celsius, 0.01 %RH, 0.01 hPa and 0.01 lx, only meaningful
+    // with SENSOR_BUS_STATUS_OK
+    int32_t values[SENSOR_BUS_CHANNEL_COUNT];
+};
+
+typedef void (*sensor_bus_handler_t)(const struct sensor_bus_record *record);
+
+static inline bool sensor_bus_record_has(const struct sensor_bus_record *record,
+                                         enum sensor_bus_channel channel)
+{
+    return record->channels & SENSOR_BUS_CHANNEL_BIT(channel);
+}
+
+static inline bool sensor_bus_record_valid(const struct sensor_bus_record *record,
+                                           enum sensor_bus_channel channel)
+{
+    return sensor_bus_record_has(record, channel) &&
+           record->status[channel] == SENSOR_BUS_STATUS_OK;
+}
+
+// Set every present channel to status, for samples that failed as a whole
+static inline void sensor_bus_record_fail(struct sensor_bus_record *record,
+                                          enum sensor_bus_status status)
+{
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        if (record->channels & SENSOR_BUS_CHANNEL_BIT(i))
+        {
+            record->status[i] = status;
+        }
+    }
+}
+
+// Fixed point value of a sensor reading. scale is the number of steps per
+// sensor unit: 100 for a reading in the channel unit, 1000 for kPa.
+// Must divide 1000000.
+static inline int32_t sensor_bus_fixed(const struct sensor_value *value,
+                                       int32_t scale)
+{
+    return value->val1 * scale + value->val2 / (1000000 / scale);
+}
+
+// Call handler once for every record published from now on that holds
+// any of the channels in the mask. The handler runs on queue, or on the
+// sensor bus work queue if queue is NULL, never in the publishing thread.
+int sensor_bus_subscribe(uint8_t channels, sensor_bus_handler_t handler,
+                         struct k_work_q *queue);
+
+// Copy record into the ring and wake the interested subscribers. Never
+// blocks. Records must all be published from the same thread.
+void sensor_bus_publish(const struct sensor_bus_record *record);
+
+// Number of records subscribers lost by falling behind
+uint32_t sensor_bus_dropped(void);
@@ -0,0 +1,123 @@
+#include "sensor_bus_zcl.h"
+
+#include <zephyr.h>
+
+// Illuminance below 1 lx is reported as too low to be measured
+#define LUX_TOO_LOW 0
+#define LUX_CENTI_OFFSET 20000
+
+// 10000 * log10(2) in Q32, turns Q16 log2 into 10000 * log10
+#define LOG10_2_Q32 197283018LL
+
+// 0.01 hPa to 0.1 kPa, 167773 / 2^24 rounds like / 100 up to 1500 hPa
+#define PRESSURE_MUL 167773
+#define PRESSURE_SHIFT 24
+
+BUILD_ASSERT(((101325LL * PRESSURE_MUL + (1LL << (PRESSURE_SHIFT - 1))) >> PRESSURE_SHIFT) == 1013,
+             "101325 in 0.01 hPa must report 1013 in 0.1 kPa");
+
+struct zcl_conversion
+{
+    // Attribute = round(value * mul / 2^shift), or its log10 scale
+    int32_t mul;
+    uint8_t shift;
+    bool log10;
+    int32_t min;
+    int32_t max;
+    int32_t invalid;
+};
+
+static const struct zcl_conversion conversions[SENSOR_BUS_CHANNEL_COUNT] = {
+    // 0.01 Celsius, down to absolute zero
+    [SENSOR_BUS_TEMPERATURE] = {
+        .mul = 1,
+        .min = -27315,
+        .max = INT16_MAX,
+        .invalid = (int16_t)0x8000,
+    },
+    // 0.01 %RH
+    [SENSOR_BUS_HUMIDITY] = {
+        .mul = 1,
+        .min = 0,
+        .max = 10000,
+        .invalid = 0xffff,
+    },
+    // 0.01 hPa to 0.1 kPa
+    [SENSOR_BUS_PRESSURE] = {
+        .mul = PRESSURE_MUL,
+        .shift = PRESSURE_SHIFT,
+        .min = INT16_MIN + 1,
+        .max = INT16_MAX,
+        .invalid = (int16_t)0x8000,
+    },
+    // 0.01 lx to 10000 * log10(lx) + 1
+    [SENSOR_BUS_LUMINOSITY] = {
+        .log10 = true,
+        .min = 1,
+        .max = 0xfffe,
+        .invalid = 0xffff,
+    },
+};
+
+// log2(1 + i / 32) in Q16
+static const uint32_t log2_table[33] = {
+    0, 2909, 5732, 8473, 11136, 13727, 16248, 18704,
+    21098, 23433, 25711, 27936, 30109, 32234, 34312, 36346,
+    38336, 40286, 42196, 44068, 45904, 47705, 49472, 51207,
+    52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047,
+    65536,
+};
+
+// log2(value) in Q16 for value > 0, within 2^-11
+static int32_t log2_q16(uint32_t value)
+{
+    uint32_t exponent = 31 - __builtin_clz(value);
+    // Mantissa with the leading one at bit 31
+    uint32_t mantissa = value << (31 - exponent);
+    uint32_t index = (mantissa >> 26) & 0x1f;
+    uint32_t frac = (mantissa >> 10) & 0xffff;
+    uint32_t low = log2_table[index];
+    uint32_t high = log2_table[index + 1];
+
+    return (exponent << 16) + low + (((high - low) * frac) >> 16);
+}
+
+static int32_t convert(const struct zcl_conversion *conv, int32_t value)
+{
+    int64_t result;
+
+    if (conv->log10)
+    {
+        // Below 1 lx, the log would be negative
+        if (value < 100)
+        {
+            return LUX_TOO_LOW;
+        }
+
+        result = ((log2_q16(value) * LOG10_2_Q32 + (1LL << 31)) >> 32) -
+                 LUX_CENTI_OFFSET + 1;
+    }
+    else
+    {
+        result = (int64_t)value * conv->mul;
+        if (conv->shift)
+        {
+            result = (result + (1LL << (conv->shift - 1))) >> conv->shift;
+        }
+    }
+
+    return CLAMP(result, conv->min, conv->max);
+}
+
+int32_t sensor_bus_zcl_value(const struct sensor_bus_record *record,
+                             enum sensor_bus_channel channel)
+{
+    const struct zcl_conversion *conv = &conversions[channel];
+
+    if (!sensor_bus_record_valid(record, channel))
+    {
+        return conv->invalid;
+    }
+
+    return convert(conv, record->values[channel]);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+// MeasuredValue attribute of the ZCL measurement cluster of channel:
+// temperature in 0.01 Celsius (int16), relative humidity in 0.01 % (uint16),
+// pressure in 0.1 kPa (int16) and illuminance as 10000 * log10(lx) + 1
+// (uint16). Values are clamped to the attribute range. Channels missing
+// from the record or not read correctly give the invalid value of the
+// attribute.
+int32_t sensor_bus_zcl_value(const struct sensor_bus_record *record,
+                             enum sensor_bus_channel channel);
@@ -0,0 +1,184 @@
+#include "sensor_filter.h"
+
+#include <zephyr.h>
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#define FILTER_DSP 1
+#endif
+
+#define WINDOW_MAX CONFIG_SUBSYS_SENSOR_FILTER_WINDOW_MAX
+
+// Fractional bits of the IIR state. Leaves 25 bits for the value,
+// more than the largest reading, 188000 lx in 0.01 lx.
+#define IIR_FRAC_BITS 6
+#define IIR_VALUE_BITS (32 - IIR_FRAC_BITS)
+
+enum filter_type
+{
+    FILTER_NONE,
+    FILTER_MEDIAN,
+    FILTER_IIR,
+    FILTER_AVERAGE,
+};
+
+struct channel_filter
+{
+    enum filter_type type;
+    // Window of the median and the average
+    uint8_t length;
+    uint8_t iir_shift;
+
+    // Samples in the window and the slot of the next one
+    uint8_t count;
+    uint8_t next;
+    int32_t window[WINDOW_MAX];
+    // Sum of the window, for the average
+    int64_t sum;
+    // Output in Q IIR_FRAC_BITS
+    int32_t iir;
+};
+
+#define FILTER_TYPE(key)                                                          \
+    (IS_ENABLED(CONFIG_SUBSYS_SENSOR_FILTER_##key##_MEDIAN)    ? FILTER_MEDIAN :  \
+     IS_ENABLED(CONFIG_SUBSYS_SENSOR_FILTER_##key##_IIR)       ? FILTER_IIR :     \
+     IS_ENABLED(CONFIG_SUBSYS_SENSOR_FILTER_##key##_AVERAGE)   ? FILTER_AVERAGE : \
+                                                                 FILTER_NONE)
+
+#define FILTER_LENGTH(key) \
+    COND_CODE_1(CONFIG_SUBSYS_SENSOR_FILTER_##key##_NONE, (1),              \
+        (COND_CODE_1(CONFIG_SUBSYS_SENSOR_FILTER_##key##_IIR, (1),          \
+            (CONFIG_SUBSYS_SENSOR_FILTER_##key##_LENGTH))))
+
+#define FILTER_IIR_SHIFT(key) \
+    COND_CODE_1(CONFIG_SUBSYS_SENSOR_FILTER_##key##_IIR,                    \
+                (CONFIG_SUBSYS_SENSOR_FILTER_##key##_IIR_SHIFT), (0))
+
+#define FILTER_INIT(key)                    \
+    {                                       \
+        .type = FILTER_TYPE(key),           \
+        .length = FILTER_LENGTH(key),       \
+        .iir_shift = FILTER_IIR_SHIFT(key), \
+    }
+
+static struct channel_filter filters[SENSOR_BUS_CHANNEL_COUNT] = {
+    [SENSOR_BUS_TEMPERATURE] = FILTER_INIT(TEMPERATURE),
+    [SENSOR_BUS_HUMIDITY] = FILTER_INIT(HUMIDITY),
+    [SENSOR_BUS_PRESSURE] = FILTER_INIT(PRESSURE),
+    [SENSOR_BUS_LUMINOSITY] = FILTER_INIT(LUMINOSITY),
+};
+
+// Returns the sample leaving the window once it is full
+static int32_t window_push(struct channel_filter *filter, int32_t value)
+{
+    int32_t oldest = filter->window[filter->next];
+
+    filter->window[filter->next] = value;
+    filter->next = (filter->next + 1) % filter->length;
+    if (filter->count < filter->length)
+    {
+        filter->count++;
+        return 0;
+    }
+
+    return oldest;
+}
+
+static int32_t median(struct channel_filter *filter, int32_t value)
+{
+    int32_t sorted[WINDOW_MAX];
+    int32_t v;
+    int j;
+
+    window_push(filter, value);
+
+    // Insertion sort, a handful of samples at most
+    for (int i = 0; i < filter->count; i++)
+    {
+        v = filter->window[i];
+        for (j = i; j > 0 && sorted[j - 1] > v; j--)
+        {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+
+    return sorted[filter->count / 2];
+}
+
+static int32_t average(struct channel_filter *filter, int32_t value)
+{
+    // Running sum, the slot of a sample not yet seen reads as 0
+    filter->sum += value - window_push(filter, value);
+
+    return filter->sum >= 0 ? (filter->sum + filter->count / 2) / filter->count :
+                              (filter->sum - filter->count / 2) / filter->count;
+}
+
+// Sample in the Q format of the IIR state, saturated
+static inline int32_t iir_input(int32_t value)
+{
+#if FILTER_DSP
+    return __ssat(value, IIR_VALUE_BITS) << IIR_FRAC_BITS;
+#else
+    return CLAMP(value, -(1 << (IIR_VALUE_BITS - 1)),
+                 (1 << (IIR_VALUE_BITS - 1)) - 1) << IIR_FRAC_BITS;
+#endif
+}
+
+static int32_t iir(struct channel_filter *filter, int32_t value)
+{
+    int32_t x = iir_input(value);
+    int32_t diff;
+
+    if (filter->count == 0)
+    {
+        // Start at the first sample instead of ramping up from 0
+        filter->count = 1;
+        filter->iir = x;
+    }
+    else
+    {
+#if FILTER_DSP
+        diff = __qsub(x, filter->iir);
+        filter->iir = __qadd(filter->iir, diff >> filter->iir_shift);
+#else
+        diff = CLAMP((int64_t)x - filter->iir, INT32_MIN, INT32_MAX);
+        filter->iir = CLAMP((int64_t)filter->iir + (diff >> filter->iir_shift),
+                            INT32_MIN, INT32_MAX);
+#endif
+    }
+
+    // Round to the nearest unit
+    return (filter->iir + (1 << (IIR_FRAC_BITS - 1))) >> IIR_FRAC_BITS;
+}
+
+void sensor_filter_apply(struct sensor_bus_record *record)
+{
+    struct channel_filter *filter;
+    int32_t *value;
+
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        if (!sensor_bus_record_valid(record, i))
+        {
+            continue;
+        }
+
+        filter = &filters[i];
+        value = &record->values[i];
+        switch (filter->type)
+        {
+        case FILTER_MEDIAN:
+            *value = median(filter, *value);
+            break;
+        case FILTER_IIR:
+            *value = iir(filter, *value);
+            break;
+        case FILTER_AVERAGE:
+            *value = average(filter, *value);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+// Filter the valid channels of record in place, as configured per channel.
+// Channels that failed are passed through and do not enter the filters.
+// Call once per sample, from the sampling thread.
+void sensor_filter_apply(struct sensor_bus_record *record);
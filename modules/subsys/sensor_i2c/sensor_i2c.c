@@ -0,0 +1,157 @@
+#include "sensor_i2c.h"
+
+#include <zephyr.h>
+#include <drivers/i2c.h>
+#include <logging/log.h>
+#if CONFIG_SHELL
+#include <shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(sensor_i2c);
+
+static sys_slist_t devices = SYS_SLIST_STATIC_INIT(&devices);
+
+void sensor_i2c_register(struct sensor_i2c_device *device)
+{
+    __ASSERT_NO_MSG(device->bus != NULL);
+
+    device->bus_errors = 0;
+    device->stats = (struct sensor_i2c_stats){0};
+    sys_slist_append(&devices, &device->node);
+}
+
+static enum sensor_i2c_cause classify(int err)
+{
+    switch (err)
+    {
+    case -EIO:
+        return SENSOR_I2C_CAUSE_BUS;
+    case -EAGAIN:
+    case -EBUSY:
+        return SENSOR_I2C_CAUSE_BUSY;
+    default:
+        return SENSOR_I2C_CAUSE_OTHER;
+    }
+}
+
+// Clock the bus free and set up every sensor on it again, as any of them
+// might have held SDA low or lost its configuration
+static void recover_bus(const struct device *bus)
+{
+    struct sensor_i2c_device *device;
+    int err;
+
+    err = i2c_recover_bus(bus);
+    if (err != 0)
+    {
+        LOG_WRN("%s recovery failed: %d", bus->name, err);
+    }
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&devices, device, node)
+    {
+        if (device->bus != bus)
+        {
+            continue;
+        }
+
+        device->bus_errors = 0;
+        if (err == 0)
+        {
+            device->stats.bus_recoveries++;
+        }
+
+        if (device->reinit == NULL)
+        {
+            continue;
+        }
+
+        device->stats.reinits++;
+        if (device->reinit() != 0)
+        {
+            LOG_WRN("%s setup failed after recovery", device->name);
+        }
+    }
+}
+
+int sensor_i2c_fetch(struct sensor_i2c_device *device,
+                     int (*fetch)(struct sensor_bus_record *record),
+                     struct sensor_bus_record *record)
+{
+    uint32_t backoff_ms = CONFIG_SUBSYS_SENSOR_I2C_BACKOFF_MS;
+    enum sensor_i2c_cause cause;
+    int err;
+
+    for (int attempt = 0;; attempt++)
+    {
+        err = fetch(record);
+        if (err == 0)
+        {
+            device->bus_errors = 0;
+            if (attempt > 0)
+            {
+                device->stats.recovered++;
+                LOG_DBG("%s recovered after %d retries", device->name, attempt);
+            }
+
+            return 0;
+        }
+
+        cause = classify(err);
+        device->stats.failures[cause]++;
+        if (cause == SENSOR_I2C_CAUSE_BUS &&
+            ++device->bus_errors >= CONFIG_SUBSYS_SENSOR_I2C_RECOVER_AFTER)
+        {
+            LOG_WRN("%s: %u bus errors, recovering %s", device->name,
+                    device->bus_errors, device->bus->name);
+            recover_bus(device->bus);
+        }
+
+        if (attempt == CONFIG_SUBSYS_SENSOR_I2C_RETRIES)
+        {
+            device->stats.exhausted++;
+            return err;
+        }
+
+        k_msleep(backoff_ms);
+        backoff_ms *= 2;
+    }
+}
+
+#if CONFIG_SHELL
+static const char *const cause_names[] = {
+    [SENSOR_I2C_CAUSE_BUS] = "bus",
+    [SENSOR_I2C_CAUSE_BUSY] = "busy",
+    [SENSOR_I2C_CAUSE_OTHER] = "other",
+};
+
+static int cmd_sensor_i2c_stats(const struct shell *shell, size_t argc,
+                                char **argv)
+{
+    struct sensor_i2c_device *device;
+    struct sensor_i2c_stats *stats;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&devices, device, node)
+    {
+        stats = &device->stats;
+        shell_print(shell, "%s: recovered %u, exhausted %u, "
+                    "bus recoveries %u, reinits %u",
+                    device->name, stats->recovered, stats->exhausted,
+                    stats->bus_recoveries, stats->reinits);
+
+        for (int i = 0; i < SENSOR_I2C_CAUSE_COUNT; i++)
+        {
+            shell_print(shell, "  %s failures: %u", cause_names[i],
+                        stats->failures[i]);
+        }
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sensor_i2c,
+    SHELL_CMD(stats, NULL, "Per sensor failure statistics",
+              cmd_sensor_i2c_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(sensor_i2c, &sub_sensor_i2c, "Sensor I2C recovery", NULL);
+#endif
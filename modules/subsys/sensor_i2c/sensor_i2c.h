@@ -0,0 +1,59 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+#include <device.h>
+#include <sys/slist.h>
+
+enum sensor_i2c_cause
+{
+    // -EIO, the sensor did not acknowledge or the bus is stuck
+    SENSOR_I2C_CAUSE_BUS,
+    // -EAGAIN or -EBUSY, the sensor was not ready yet
+    SENSOR_I2C_CAUSE_BUSY,
+    // Anything else, like data out of range
+    SENSOR_I2C_CAUSE_OTHER,
+    SENSOR_I2C_CAUSE_COUNT,
+};
+
+struct sensor_i2c_stats
+{
+    uint32_t failures[SENSOR_I2C_CAUSE_COUNT];
+    // Fetches that succeeded after a retry
+    uint32_t recovered;
+    // Fetches that still failed after the last retry
+    uint32_t exhausted;
+    uint32_t bus_recoveries;
+    uint32_t reinits;
+};
+
+struct sensor_i2c_device
+{
+    const char *name;
+    // Bus controller the sensor sits on
+    const struct device *bus;
+    // Optional. Set the sensor up again after a bus recovery.
+    int (*reinit)(void);
+
+    // Private, managed by sensor_i2c
+    sys_snode_t node;
+    // Consecutive bus errors
+    uint8_t bus_errors;
+    struct sensor_i2c_stats stats;
+};
+
+/*
+ * Make a sensor known to the recovery. Sensors sharing its bus are set up
+ * again when the bus is recovered on behalf of any of them.
+ */
+void sensor_i2c_register(struct sensor_i2c_device *device);
+
+/*
+ * Run fetch, retrying it with a doubling backoff until it succeeds or the
+ * retries are used up, and recover the bus on repeated bus errors.
+ * Returns the result of the last attempt. Only to be called from the
+ * sensor scheduler thread.
+ */
+int sensor_i2c_fetch(struct sensor_i2c_device *device,
+                     int (*fetch)(struct sensor_bus_record *record),
+                     struct sensor_bus_record *record);
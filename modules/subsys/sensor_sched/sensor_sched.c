@@ -0,0 +1,328 @@
+#include "sensor_sched.h"
+
+#include <zephyr.h>
+#include <logging/log.h>
+#include <stdlib.h>
+#if CONFIG_SUBSYS_SENSOR_SCHED_BUS_PM
+#include <pm/device.h>
+#endif
+#if CONFIG_SHELL
+#include <shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(sensor_sched);
+
+static void sensor_sched_entry_point(void *, void *, void *);
+
+K_THREAD_DEFINE(sensor_sched, CONFIG_SUBSYS_SENSOR_SCHED_STACK_SIZE,
+                sensor_sched_entry_point, NULL, NULL, NULL,
+                CONFIG_SUBSYS_SENSOR_SCHED_THREAD_PRIORITY, 0, 0);
+
+static sys_slist_t tasks = SYS_SLIST_STATIC_INIT(&tasks);
+
+// Given by sensor_sched_request(). Unlike k_wakeup(), a request made
+// while the thread is still computing its next sleep is not lost.
+static K_SEM_DEFINE(request_sem, 0, 1);
+
+// Bus activity of the current wakeup
+static struct
+{
+    bool open;
+    uint32_t start;
+    uint32_t transactions;
+} window;
+
+static struct sensor_sched_window_stats window_stats;
+
+void sensor_sched_register(struct sensor_sched_task *task)
+{
+    __ASSERT_NO_MSG(task->sample != NULL);
+
+    task->deadline = task->period_ms ? k_uptime_get() + task->period_ms :
+                                       INT64_MAX;
+    task->converting = false;
+    atomic_clear(&task->requested);
+    task->stats = (struct sensor_sched_stats){
+        .jitter_min_ms = INT32_MAX,
+        .jitter_max_ms = INT32_MIN,
+    };
+    sys_slist_append(&tasks, &task->node);
+}
+
+void sensor_sched_request(struct sensor_sched_task *task)
+{
+    atomic_set(&task->requested, 1);
+    k_sem_give(&request_sem);
+}
+
+void sensor_sched_set_period(struct sensor_sched_task *task,
+                             uint32_t period_ms)
+{
+    __ASSERT_NO_MSG(period_ms > 0);
+
+    if (period_ms != task->period_ms)
+    {
+        LOG_DBG("%s period %u ms", task->name, period_ms);
+        task->period_ms = period_ms;
+    }
+}
+
+uint32_t sensor_sched_adapt(struct sensor_sched_adaptive *adaptive,
+                            int32_t value)
+{
+    // Compare against the last change, so slow drifts add up
+    if (!adaptive->has_reference || abs(value - adaptive->reference) > adaptive->band)
+    {
+        adaptive->reference = value;
+        adaptive->has_reference = true;
+        adaptive->interval_ms = adaptive->min_ms;
+    }
+    else
+    {
+        adaptive->interval_ms = MIN(adaptive->interval_ms * 2, adaptive->max_ms);
+    }
+
+    return adaptive->interval_ms;
+}
+
+uint32_t sensor_sched_adapt_reset(struct sensor_sched_adaptive *adaptive)
+{
+    adaptive->has_reference = false;
+    adaptive->interval_ms = adaptive->min_ms;
+
+    return adaptive->interval_ms;
+}
+
+static void finish_task(struct sensor_sched_task *task)
+{
+    struct sensor_sched_stats *stats = &task->stats;
+    int64_t start = k_uptime_get();
+    int64_t end;
+    uint32_t missed;
+
+    task->sample();
+    end = k_uptime_get();
+    task->converting = false;
+
+    stats->runs++;
+    stats->duration_max_ms = MAX(stats->duration_max_ms,
+                                 task->trigger_ms + (end - start));
+
+    if (task->period_ms == 0)
+    {
+        task->deadline = INT64_MAX;
+        return;
+    }
+
+    // Advance from the deadline, not from now, so the period never drifts
+    task->deadline += task->period_ms;
+    if (task->deadline <= end)
+    {
+        missed = (end - task->deadline) / task->period_ms + 1;
+        task->deadline += (int64_t)missed * task->period_ms;
+        stats->missed += missed;
+        LOG_WRN("%s missed %u periods", task->name, missed);
+    }
+}
+
+static void start_task(struct sensor_sched_task *task)
+{
+    struct sensor_sched_stats *stats = &task->stats;
+    int64_t start = k_uptime_get();
+    int32_t jitter = start - task->deadline;
+    uint32_t conversion_ms;
+
+    stats->jitter_sum_ms += jitter;
+    stats->jitter_min_ms = MIN(stats->jitter_min_ms, jitter);
+    stats->jitter_max_ms = MAX(stats->jitter_max_ms, jitter);
+
+    if (task->trigger == NULL)
+    {
+        task->trigger_ms = 0;
+        finish_task(task);
+        return;
+    }
+
+    conversion_ms = task->trigger();
+    task->trigger_ms = k_uptime_get() - start;
+    task->ready = start + conversion_ms;
+    task->converting = true;
+}
+
+static void set_buses_active(bool active)
+{
+#if CONFIG_SUBSYS_SENSOR_SCHED_BUS_PM
+    struct sensor_sched_task *task;
+    int err;
+
+    // Sensors sharing a bus find it in the state already
+    SYS_SLIST_FOR_EACH_CONTAINER(&tasks, task, node)
+    {
+        if (task->bus == NULL)
+        {
+            continue;
+        }
+
+        err = pm_device_state_set(task->bus, active ? PM_DEVICE_STATE_ACTIVE :
+                                                      PM_DEVICE_STATE_SUSPENDED);
+        if (err != 0 && err != -EALREADY)
+        {
+            LOG_WRN("%s bus %s failed: %d", task->name,
+                    active ? "resume" : "suspend", err);
+        }
+    }
+#endif
+}
+
+// Account a call of a task about to touch its bus
+static void window_use(const struct sensor_sched_task *task)
+{
+    if (task->bus == NULL)
+    {
+        return;
+    }
+
+    if (!window.open)
+    {
+        window.open = true;
+        window.start = k_cycle_get_32();
+        window.transactions = 0;
+        set_buses_active(true);
+    }
+
+    window.transactions++;
+}
+
+static void window_close(void)
+{
+    uint32_t bus_time_us;
+
+    if (!window.open)
+    {
+        return;
+    }
+
+    set_buses_active(false);
+    bus_time_us = k_cyc_to_us_floor32(k_cycle_get_32() - window.start);
+    window.open = false;
+
+    window_stats.windows++;
+    window_stats.transactions += window.transactions;
+    window_stats.transactions_max = MAX(window_stats.transactions_max,
+                                        window.transactions);
+    window_stats.bus_time_sum_us += bus_time_us;
+    window_stats.bus_time_max_us = MAX(window_stats.bus_time_max_us,
+                                       bus_time_us);
+}
+
+static inline int64_t next_event(const struct sensor_sched_task *task)
+{
+    if (task->converting)
+    {
+        return task->ready;
+    }
+
+    return atomic_get(&task->requested) ? 0 : task->deadline;
+}
+
+static void sensor_sched_entry_point(void *u1, void *u2, void *u3)
+{
+    struct sensor_sched_task *task;
+    int64_t next;
+    int64_t now;
+
+    if (sys_slist_is_empty(&tasks))
+    {
+        LOG_WRN("No sensors to sample");
+        return;
+    }
+
+    while (1)
+    {
+        next = INT64_MAX;
+        SYS_SLIST_FOR_EACH_CONTAINER(&tasks, task, node)
+        {
+            next = MIN(next, next_event(task));
+        }
+
+        // sensor_sched_request() cuts the wait short
+        k_sem_take(&request_sem,
+                   next == INT64_MAX ? K_FOREVER : K_TIMEOUT_ABS_MS(next));
+
+        // Read out finished conversions, then start everything due within
+        // the window in this wakeup
+        now = k_uptime_get();
+        SYS_SLIST_FOR_EACH_CONTAINER(&tasks, task, node)
+        {
+            if (task->converting && task->ready <= now)
+            {
+                window_use(task);
+                finish_task(task);
+            }
+
+            // Restart the period from the requested sample
+            if (!task->converting && atomic_clear(&task->requested))
+            {
+                task->deadline = now;
+            }
+        }
+
+        SYS_SLIST_FOR_EACH_CONTAINER(&tasks, task, node)
+        {
+            if (!task->converting &&
+                task->deadline <= now + CONFIG_SUBSYS_SENSOR_SCHED_ALIGN_WINDOW_MS)
+            {
+                window_use(task);
+                start_task(task);
+            }
+        }
+
+        window_close();
+    }
+}
+
+#if CONFIG_SHELL
+static int cmd_sensor_sched_stats(const struct shell *shell, size_t argc,
+                                  char **argv)
+{
+    struct sensor_sched_task *task;
+    struct sensor_sched_stats *stats;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&tasks, task, node)
+    {
+        stats = &task->stats;
+        if (stats->runs == 0)
+        {
+            shell_print(shell, "%s: no samples yet", task->name);
+            continue;
+        }
+
+        shell_print(shell, "%s: period %u ms, runs %u, missed %u, "
+                    "jitter %d/%d/%d ms (min/avg/max), duration max %u ms",
+                    task->name, task->period_ms, stats->runs, stats->missed,
+                    stats->jitter_min_ms,
+                    (int32_t)(stats->jitter_sum_ms / stats->runs),
+                    stats->jitter_max_ms, stats->duration_max_ms);
+    }
+
+    if (window_stats.windows > 0)
+    {
+        shell_print(shell, "bus: windows %u, transactions %u (max %u), "
+                    "bus time %u/%u us (avg/max)",
+                    window_stats.windows, window_stats.transactions,
+                    window_stats.transactions_max,
+                    (uint32_t)(window_stats.bus_time_sum_us / window_stats.windows),
+                    window_stats.bus_time_max_us);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sensor_sched,
+    SHELL_CMD(stats, NULL, "Per sensor jitter and bus window statistics",
+              cmd_sensor_sched_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(sensor_sched, &sub_sensor_sched, "Sensor scheduler",
+                   NULL);
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <device.h>
+#include <sys/atomic.h>
+#include <sys/slist.h>
+
+struct sensor_sched_stats
+{
+    uint32_t runs;
+    // Periods skipped because a sample ran late
+    uint32_t missed;
+    // Start time minus deadline, negative when aligned to an earlier one
+    int32_t jitter_min_ms;
+    int32_t jitter_max_ms;
+    int64_t jitter_sum_ms;
+    // Time spent in trigger and sample, without the conversion
+    uint32_t duration_max_ms;
+};
+
+// Bus activity of the scheduler wakeups that ran bus sensors
+struct sensor_sched_window_stats
+{
+    uint32_t windows;
+    // Trigger and sample calls of bus sensors
+    uint32_t transactions;
+    uint32_t transactions_max;
+    // From resuming the buses to suspending them
+    uint64_t bus_time_sum_us;
+    uint32_t bus_time_max_us;
+};
+
+struct sensor_sched_task
+{
+    const char *name;
+    // 0 to sample only on sensor_sched_request()
+    uint32_t period_ms;
+    /*
+     * Optional. Start a conversion at the deadline and return the time in
+     * ms until its result can be read. The scheduler sleeps meanwhile, or
+     * serves other sensors, and then calls sample.
+     */
+    uint32_t (*trigger)(void);
+    void (*sample)(void);
+    /*
+     * Optional. Bus the sensor sits on. Calls of all sensors due in one
+     * wakeup share one window of bus activity, outside of which the bus
+     * is suspended with SUBSYS_SENSOR_SCHED_BUS_PM.
+     */
+    const struct device *bus;
+
+    // Private, managed by the scheduler
+    sys_snode_t node;
+    int64_t deadline;
+    // Time sample is due while a triggered conversion runs
+    int64_t ready;
+    bool converting;
+    uint32_t trigger_ms;
+    atomic_t requested;
+    struct sensor_sched_stats stats;
+};
+
+/*
+ * Change driven sampling interval of one channel. The interval doubles
+ * with every reading within band of the reference reading, up to max_ms.
+ * A reading outside the band becomes the new reference and drops the
+ * interval back to min_ms.
+ */
+struct sensor_sched_adaptive
+{
+    uint32_t min_ms;
+    uint32_t max_ms;
+    // In the unit of the readings
+    int32_t band;
+
+    // Private, managed by sensor_sched_adapt()
+    uint32_t interval_ms;
+    int32_t reference;
+    bool has_reference;
+};
+
+#define SENSOR_SCHED_ADAPTIVE_INITIALIZER(_min_ms, _max_ms, _band) \
+    {                                                               \
+        .min_ms = (_min_ms),                                        \
+        .max_ms = (_max_ms),                                        \
+        .band = (_band),                                            \
+        .interval_ms = (_min_ms),                                   \
+    }
+
+/*
+ * Sample the task every period_ms, first one period from now. Must be
+ * called before the scheduler thread starts, from SYS_INIT at
+ * APPLICATION level at the latest.
+ */
+void sensor_sched_register(struct sensor_sched_task *task);
+
+/*
+ * Sample the task as soon as possible, for sensors signalling a change.
+ * The next periodic sample follows one period after this one. Can be
+ * called from any context, including interrupts.
+ */
+void sensor_sched_request(struct sensor_sched_task *task);
+
+/*
+ * Change the period of a task, starting with its next deadline. Only to
+ * be called from the sample function of the task.
+ */
+void sensor_sched_set_period(struct sensor_sched_task *task,
+                             uint32_t period_ms);
+
+/*
+ * Feed a reading to the adaptive interval of a channel and return the
+ * interval the channel wants next.
+ */
+uint32_t sensor_sched_adapt(struct sensor_sched_adaptive *adaptive,
+                            int32_t value);
+
+/*
+ * Return to the shortest interval, for a channel that could not be read.
+ * The next reading becomes the new reference.
+ */
+uint32_t sensor_sched_adapt_reset(struct sensor_sched_adaptive *adaptive);
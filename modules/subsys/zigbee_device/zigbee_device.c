@@ -0,0 +1,577 @@
+#include "zigbee_device.h"
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+#include "zigbee_report.h"
+#endif
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+#include "zigbee_poll.h"
+#endif
+#include "sensor_bus_zcl.h"
+
+#include <zephyr.h>
+#include <logging/log.h>
+#include <string.h>
+
+#include <zboss_api.h>
+#include <zboss_api_addons.h>
+#include <zb_nrf_platform.h>
+#include <zigbee/zigbee_app_utils.h>
+#include <zigbee/zigbee_error_handler.h>
+
+#include "zb_mem_config_custom.h"
+#include "zb_multi_sensor.h"
+#include "zb_zcl_illuminance_measurement_addons.h"
+#include "zb_zcl_power_config_addons.h"
+#include "zb_zcl_pressure_measurement_addons.h"
+#include "zb_zcl_rel_humidity_measurement_addons.h"
+
+LOG_MODULE_REGISTER(zigbee_device);
+
+#define ENDPOINT CONFIG_SUBSYS_ZIGBEE_DEVICE_ENDPOINT
+
+#define BASIC_APP_VERSION 1
+#define BASIC_STACK_VERSION 10
+#define BASIC_HW_VERSION 1
+#define BASIC_MANUF_NAME "EFEKTA"
+#define BASIC_MODEL_ID "EINK290"
+
+// Attribute ranges in ZCL units, as far as the sensors measure
+#define TEMPERATURE_MIN (-4000)
+#define TEMPERATURE_MAX 8500
+// 1 Celsius
+#define TEMPERATURE_TOLERANCE 100
+#define HUMIDITY_MIN 0
+#define HUMIDITY_MAX 10000
+#define PRESSURE_MIN 300
+#define PRESSURE_MAX 1100
+// 1 hPa
+#define PRESSURE_TOLERANCE 1
+// 1 lx to 188000 lx
+#define ILLUMINANCE_MIN 1
+#define ILLUMINANCE_MAX 52742
+
+// Channels with a measurement cluster on the endpoint
+#define MEASURED_CHANNELS                                                 \
+    ((IS_ENABLED(CONFIG_SUBSYS_BME280) ?                                  \
+          SENSOR_BUS_CHANNEL_BIT(SENSOR_BUS_TEMPERATURE) |                \
+              SENSOR_BUS_CHANNEL_BIT(SENSOR_BUS_HUMIDITY) |               \
+              SENSOR_BUS_CHANNEL_BIT(SENSOR_BUS_PRESSURE) : 0) |          \
+     (IS_ENABLED(CONFIG_SUBSYS_MAX44009) ?                                \
+          SENSOR_BUS_CHANNEL_BIT(SENSOR_BUS_LUMINOSITY) : 0))
+
+// ZCL 3.3.2.2.1, in 100 mV
+#define BATTERY_VOLTAGE_UNKNOWN 0xff
+#define BATTERY_SIZE_UNKNOWN 0xff
+#define BATTERY_RATED_VOLTAGE 30
+
+struct zb_device_ctx
+{
+    zb_zcl_basic_attrs_ext_t basic_attr;
+    zb_zcl_identify_attrs_t identify_attr;
+#if CONFIG_SUBSYS_BME280
+    zb_zcl_temp_measurement_attrs_t temp_attr;
+    zb_zcl_rel_humidity_measurement_attrs_t humidity_attr;
+    zb_zcl_pressure_measurement_attrs_t pressure_attr;
+#endif
+#if CONFIG_SUBSYS_MAX44009
+    zb_zcl_illuminance_measurement_attrs_t illuminance_attr;
+#endif
+    zb_zcl_power_config_attrs_t power_attr;
+};
+
+static struct zb_device_ctx dev_ctx;
+
+ZB_ZCL_DECLARE_IDENTIFY_ATTRIB_LIST(identify_attr_list,
+                                    &dev_ctx.identify_attr.identify_time);
+
+ZB_ZCL_DECLARE_BASIC_ATTRIB_LIST_EXT(basic_attr_list,
+                                     &dev_ctx.basic_attr.zcl_version,
+                                     &dev_ctx.basic_attr.app_version,
+                                     &dev_ctx.basic_attr.stack_version,
+                                     &dev_ctx.basic_attr.hw_version,
+                                     dev_ctx.basic_attr.mf_name,
+                                     dev_ctx.basic_attr.model_id,
+                                     dev_ctx.basic_attr.date_code,
+                                     &dev_ctx.basic_attr.power_source,
+                                     dev_ctx.basic_attr.location_id,
+                                     &dev_ctx.basic_attr.ph_env,
+                                     dev_ctx.basic_attr.sw_ver);
+
+#if CONFIG_SUBSYS_BME280
+ZB_ZCL_DECLARE_TEMP_MEASUREMENT_ATTRIB_LIST(temp_measure_attr_list,
+                                            &dev_ctx.temp_attr.measure_value,
+                                            &dev_ctx.temp_attr.min_measure_value,
+                                            &dev_ctx.temp_attr.max_measure_value,
+                                            &dev_ctx.temp_attr.tolerance);
+
+ZB_ZCL_DECLARE_REL_HUMIDITY_MEASUREMENT_ATTRIB_LIST(humm_measure_attr_list,
+                                                    &dev_ctx.humidity_attr.measure_value,
+                                                    &dev_ctx.humidity_attr.min_measure_value,
+                                                    &dev_ctx.humidity_attr.max_measure_value);
+
+ZB_ZCL_DECLARE_PRESSURE_MEASUREMENT_ATTRIB_LIST(pres_measure_attr_list,
+                                                &dev_ctx.pressure_attr.measure_value,
+                                                &dev_ctx.pressure_attr.min_measure_value,
+                                                &dev_ctx.pressure_attr.max_measure_value,
+                                                &dev_ctx.pressure_attr.tolerance);
+#endif
+
+#if CONFIG_SUBSYS_MAX44009
+ZB_ZCL_DECLARE_ILLUMINANCE_MEASUREMENT_ATTRIB_LIST(illuminance_measure_attr_list,
+                                                   &dev_ctx.illuminance_attr.measure_value,
+                                                   &dev_ctx.illuminance_attr.min_measure_value,
+                                                   &dev_ctx.illuminance_attr.max_measure_value);
+#endif
+
+ZB_ZCL_DECLARE_POWER_CONFIG_ATTRIB_LIST(power_config_attr_list,
+                                        &dev_ctx.power_attr.battery_voltage,
+                                        &dev_ctx.power_attr.battery_size,
+                                        &dev_ctx.power_attr.battery_quantity,
+                                        &dev_ctx.power_attr.battery_rated_voltage,
+                                        &dev_ctx.power_attr.battery_alarm_mask,
+                                        &dev_ctx.power_attr.battery_voltage_min_threshold);
+
+ZB_DECLARE_MULTI_SENSOR_CLUSTER_LIST(multi_sensor_clusters,
+                                     basic_attr_list,
+                                     identify_attr_list,
+                                     temp_measure_attr_list,
+                                     humm_measure_attr_list,
+                                     pres_measure_attr_list,
+                                     illuminance_measure_attr_list,
+                                     power_config_attr_list);
+
+ZB_ZCL_DECLARE_MULTI_SENSOR_EP(multi_sensor_ep, ENDPOINT, multi_sensor_clusters);
+
+ZBOSS_DECLARE_DEVICE_CTX_1_EP(multi_sensor_ctx, multi_sensor_ep);
+
+// MeasuredValue attribute of each channel
+static const struct
+{
+    zb_uint16_t cluster;
+    zb_uint16_t attribute;
+} measured_values[SENSOR_BUS_CHANNEL_COUNT] = {
+    [SENSOR_BUS_TEMPERATURE] = {ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+                                ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID},
+    [SENSOR_BUS_HUMIDITY] = {ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,
+                             ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID},
+    [SENSOR_BUS_PRESSURE] = {ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT,
+                             ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_ID},
+    [SENSOR_BUS_LUMINOSITY] = {ZB_ZCL_CLUSTER_ID_ILLUMINANCE_MEASUREMENT,
+                               ZB_ZCL_ATTR_ILLUMINANCE_MEASUREMENT_MEASURED_VALUE_ID},
+};
+
+// Latest channels not applied yet, merged over all records since the
+// last apply. Written by the sensor bus thread, read by the Zigbee thread.
+static struct k_spinlock pending_lock;
+static struct sensor_bus_record pending;
+// Set while an apply callback waits in the Zigbee scheduler
+static atomic_t apply_queued;
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+// Uptime the deferred values are applied at, INT64_MAX if none wait
+static int64_t deferred_at = INT64_MAX;
+#endif
+
+static void clusters_attr_init(void)
+{
+    // No channels, every measured value starts out invalid
+    const struct sensor_bus_record none = {0};
+
+    dev_ctx.basic_attr.zcl_version = ZB_ZCL_VERSION;
+    dev_ctx.basic_attr.app_version = BASIC_APP_VERSION;
+    dev_ctx.basic_attr.stack_version = BASIC_STACK_VERSION;
+    dev_ctx.basic_attr.hw_version = BASIC_HW_VERSION;
+    dev_ctx.basic_attr.power_source = ZB_ZCL_BASIC_POWER_SOURCE_BATTERY;
+    dev_ctx.basic_attr.ph_env = ZB_ZCL_BASIC_ENV_UNSPECIFIED;
+    ZB_ZCL_SET_STRING_VAL(dev_ctx.basic_attr.mf_name, BASIC_MANUF_NAME,
+                          ZB_ZCL_STRING_CONST_SIZE(BASIC_MANUF_NAME));
+    ZB_ZCL_SET_STRING_VAL(dev_ctx.basic_attr.model_id, BASIC_MODEL_ID,
+                          ZB_ZCL_STRING_CONST_SIZE(BASIC_MODEL_ID));
+
+    dev_ctx.identify_attr.identify_time = ZB_ZCL_IDENTIFY_IDENTIFY_TIME_DEFAULT_VALUE;
+
+#if CONFIG_SUBSYS_BME280
+    dev_ctx.temp_attr.measure_value = sensor_bus_zcl_value(&none, SENSOR_BUS_TEMPERATURE);
+    dev_ctx.temp_attr.min_measure_value = TEMPERATURE_MIN;
+    dev_ctx.temp_attr.max_measure_value = TEMPERATURE_MAX;
+    dev_ctx.temp_attr.tolerance = TEMPERATURE_TOLERANCE;
+
+    dev_ctx.humidity_attr.measure_value = sensor_bus_zcl_value(&none, SENSOR_BUS_HUMIDITY);
+    dev_ctx.humidity_attr.min_measure_value = HUMIDITY_MIN;
+    dev_ctx.humidity_attr.max_measure_value = HUMIDITY_MAX;
+
+    dev_ctx.pressure_attr.measure_value = sensor_bus_zcl_value(&none, SENSOR_BUS_PRESSURE);
+    dev_ctx.pressure_attr.min_measure_value = PRESSURE_MIN;
+    dev_ctx.pressure_attr.max_measure_value = PRESSURE_MAX;
+    dev_ctx.pressure_attr.tolerance = PRESSURE_TOLERANCE;
+#endif
+
+#if CONFIG_SUBSYS_MAX44009
+    dev_ctx.illuminance_attr.measure_value = sensor_bus_zcl_value(&none, SENSOR_BUS_LUMINOSITY);
+    dev_ctx.illuminance_attr.min_measure_value = ILLUMINANCE_MIN;
+    dev_ctx.illuminance_attr.max_measure_value = ILLUMINANCE_MAX;
+#endif
+
+    dev_ctx.power_attr.battery_voltage = BATTERY_VOLTAGE_UNKNOWN;
+    dev_ctx.power_attr.battery_size = BATTERY_SIZE_UNKNOWN;
+    dev_ctx.power_attr.battery_quantity = 1;
+    dev_ctx.power_attr.battery_rated_voltage = BATTERY_RATED_VOLTAGE;
+}
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+// Report the measured values by the device defaults until the coordinator
+// configures them. Keeps configurations restored from flash.
+static void install_reporting(void)
+{
+    zb_zcl_reporting_info_t info;
+
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        // No cluster, and no reporting slot, for disabled sensors
+        if (!(MEASURED_CHANNELS & SENSOR_BUS_CHANNEL_BIT(i)))
+        {
+            continue;
+        }
+
+        memset(&info, 0, sizeof(info));
+        info.direction = ZB_ZCL_CONFIGURE_REPORTING_SEND_REPORT;
+        info.ep = ENDPOINT;
+        info.cluster_id = measured_values[i].cluster;
+        info.cluster_role = ZB_ZCL_CLUSTER_SERVER_ROLE;
+        info.attr_id = measured_values[i].attribute;
+        info.manuf_code = ZB_ZCL_MANUFACTURER_WILDCARD_ID;
+        info.dst.profile_id = ZB_AF_HA_PROFILE_ID;
+        zigbee_report_defaults(i, &info);
+
+        if (zb_zcl_put_reporting_info(&info, ZB_FALSE) != RET_OK)
+        {
+            LOG_WRN("No reporting slot for cluster 0x%04x", info.cluster_id);
+        }
+    }
+}
+
+// Whether to set value as the attribute of channel now. A value that has
+// to wait is put back, unless a newer one arrived meanwhile.
+static bool report_due(const struct sensor_bus_record *batch,
+                       enum sensor_bus_channel channel, int32_t value,
+                       int64_t now, uint32_t *defer_ms)
+{
+    const zb_zcl_reporting_info_t *info;
+    k_spinlock_key_t key;
+    uint32_t wait_ms;
+
+    info = zb_zcl_find_reporting_info(ENDPOINT, measured_values[channel].cluster,
+                                      ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                      measured_values[channel].attribute);
+
+    switch (zigbee_report_check(channel, info, value, now, &wait_ms))
+    {
+    case ZIGBEE_REPORT_WRITE:
+        return true;
+    case ZIGBEE_REPORT_DEFER:
+        key = k_spin_lock(&pending_lock);
+        if (!sensor_bus_record_has(&pending, channel))
+        {
+            pending.status[channel] = batch->status[channel];
+            pending.values[channel] = batch->values[channel];
+            pending.channels |= SENSOR_BUS_CHANNEL_BIT(channel);
+        }
+        k_spin_unlock(&pending_lock, key);
+
+        *defer_ms = MIN(*defer_ms, wait_ms);
+        return false;
+    default:
+        return false;
+    }
+}
+#endif
+
+static void write_measured_value(enum sensor_bus_channel channel,
+                                 int32_t zcl_value)
+{
+    // Signed and unsigned attributes are all 16 bit wide
+    zb_uint16_t value = zcl_value;
+    zb_zcl_status_t status;
+
+    status = ZB_ZCL_SET_ATTRIBUTE(ENDPOINT, measured_values[channel].cluster,
+                                  ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                  measured_values[channel].attribute,
+                                  (zb_uint8_t *)&value, ZB_FALSE);
+    if (status != ZB_ZCL_STATUS_SUCCESS)
+    {
+        LOG_WRN("Failed to set cluster 0x%04x: %d",
+                measured_values[channel].cluster, status);
+        return;
+    }
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+    zigbee_report_written(channel, zcl_value, k_uptime_get());
+#endif
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    // Pick up the acknowledgements of the report
+    zigbee_poll_fast(CONFIG_SUBSYS_ZIGBEE_DEVICE_TRANSFER_FAST_POLL_MS);
+#endif
+}
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS > 0
+static void drain_pending(void);
+
+// Values waiting for the transmit window, only used in the Zigbee thread
+static uint8_t window_channels;
+static int32_t window_values[SENSOR_BUS_CHANNEL_COUNT];
+static int64_t window_flush_at;
+#endif
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+// Tell the poll controller when the next reports leave: with the open
+// window, with the window of the deferred values, or periodically
+static void announce_next_report(void)
+{
+    int64_t next = INT64_MAX;
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS > 0
+    if (window_channels != 0)
+    {
+        next = window_flush_at;
+    }
+#endif
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+    if (deferred_at != INT64_MAX)
+    {
+        next = MIN(next, deferred_at + CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS);
+    }
+    next = MIN(next, zigbee_report_next());
+#endif
+
+    zigbee_poll_report_at(next);
+}
+#endif
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS > 0
+// Set all values of the window back to back, so their reports leave in
+// one radio-on period and share a frame per cluster
+static void flush_window(zb_uint8_t param)
+{
+    ARG_UNUSED(param);
+
+    // Deferred values due by now join the window. A queued apply stays
+    // queued and finds the record empty or refilled.
+    drain_pending();
+
+    LOG_DBG("Flushing 0x%x", window_channels);
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        if (window_channels & SENSOR_BUS_CHANNEL_BIT(i))
+        {
+            write_measured_value(i, window_values[i]);
+        }
+    }
+    window_channels = 0;
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    announce_next_report();
+#endif
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_SLEEPY && \
+    !CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    // Poll right after the reports, while the radio is on anyway
+    zb_zdo_pim_start_turbo_poll_packets(1);
+#endif
+}
+#endif
+
+static void set_measured_value(enum sensor_bus_channel channel,
+                               int32_t zcl_value)
+{
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS > 0
+    // The first value opens the window, later ones join it
+    if (window_channels == 0)
+    {
+        window_flush_at = k_uptime_get() + CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS;
+        ZB_SCHEDULE_APP_ALARM(flush_window, 0,
+                              ZB_MILLISECONDS_TO_BEACON_INTERVAL(
+                                  CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_WINDOW_MS));
+    }
+
+    window_channels |= SENSOR_BUS_CHANNEL_BIT(channel);
+    window_values[channel] = zcl_value;
+#else
+    write_measured_value(channel, zcl_value);
+#endif
+}
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+static void apply_deferred(zb_uint8_t param);
+#endif
+
+// Runs in the Zigbee thread, takes all pending values in one go
+static void drain_pending(void)
+{
+    struct sensor_bus_record batch;
+    k_spinlock_key_t key;
+    int32_t zcl_value;
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+    int64_t now = k_uptime_get();
+    uint32_t defer_ms = UINT32_MAX;
+#endif
+
+    key = k_spin_lock(&pending_lock);
+    batch = pending;
+    pending.channels = 0;
+    k_spin_unlock(&pending_lock, key);
+
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        if (!sensor_bus_record_has(&batch, i))
+        {
+            continue;
+        }
+
+        zcl_value = sensor_bus_zcl_value(&batch, i);
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+        if (!report_due(&batch, i, zcl_value, now, &defer_ms))
+        {
+            continue;
+        }
+#endif
+
+        set_measured_value(i, zcl_value);
+    }
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+    // Apply the deferred values once the first of them is due
+    if (defer_ms != UINT32_MAX)
+    {
+        deferred_at = now + defer_ms;
+        ZB_SCHEDULE_APP_ALARM_CANCEL(apply_deferred, ZB_ALARM_ANY_PARAM);
+        ZB_SCHEDULE_APP_ALARM(apply_deferred, 0,
+                              ZB_MILLISECONDS_TO_BEACON_INTERVAL(defer_ms));
+    }
+#endif
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    announce_next_report();
+#endif
+}
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+static void apply_deferred(zb_uint8_t param)
+{
+    ARG_UNUSED(param);
+
+    deferred_at = INT64_MAX;
+    drain_pending();
+}
+#endif
+
+// Queued by zigbee_device_publish_record()
+static void apply_pending(zb_uint8_t param)
+{
+    ARG_UNUSED(param);
+
+    // Records published from here on queue the next apply
+    atomic_clear(&apply_queued);
+    drain_pending();
+}
+
+void zigbee_device_publish_record(const struct sensor_bus_record *record)
+{
+    k_spinlock_key_t key;
+
+    if (!(record->channels & MEASURED_CHANNELS))
+    {
+        return;
+    }
+
+    key = k_spin_lock(&pending_lock);
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        if (sensor_bus_record_has(record, i))
+        {
+            pending.status[i] = record->status[i];
+            pending.values[i] = record->values[i];
+        }
+    }
+    pending.channels |= record->channels & MEASURED_CHANNELS;
+    pending.timestamp = record->timestamp;
+    k_spin_unlock(&pending_lock, key);
+
+    // A queued apply picks the record up as well
+    if (!atomic_cas(&apply_queued, 0, 1))
+    {
+        return;
+    }
+
+    if (zigbee_schedule_callback(apply_pending, 0) != RET_OK)
+    {
+        // The next record tries again
+        atomic_clear(&apply_queued);
+        LOG_WRN("Zigbee scheduler queue full");
+    }
+}
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+// Sees every frame to the endpoint before the ZCL processes it
+static zb_uint8_t endpoint_handler(zb_bufid_t bufid)
+{
+    ARG_UNUSED(bufid);
+
+    zigbee_poll_fast(CONFIG_SUBSYS_ZIGBEE_DEVICE_COMMAND_FAST_POLL_MS);
+
+    return ZB_FALSE;
+}
+#endif
+
+void zboss_signal_handler(zb_bufid_t bufid)
+{
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING || \
+    CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    zb_zdo_app_signal_type_t signal = zb_get_app_signal(bufid, NULL);
+    zb_ret_t status = ZB_GET_APP_SIGNAL_STATUS(bufid);
+    bool started = (signal == ZB_BDB_SIGNAL_DEVICE_FIRST_START ||
+                    signal == ZB_BDB_SIGNAL_DEVICE_REBOOT) &&
+                   status == RET_OK;
+#endif
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORTING
+    // The ZCL reporting table is usable once the stack started
+    if (started)
+    {
+        install_reporting();
+    }
+#endif
+
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    if (started || (signal == ZB_BDB_SIGNAL_STEERING && status == RET_OK))
+    {
+        zigbee_poll_joined();
+    }
+    else if (signal == ZB_ZDO_SIGNAL_LEAVE)
+    {
+        // The default handler rejoins
+        zigbee_poll_joining();
+    }
+#endif
+
+    ZB_ERROR_CHECK(zigbee_default_signal_handler(bufid));
+
+    if (bufid)
+    {
+        zb_buf_free(bufid);
+    }
+}
+
+void start_zigbee_device(void)
+{
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_SLEEPY
+    zigbee_configure_sleepy_behavior(true);
+#endif
+
+    ZB_AF_REGISTER_DEVICE_CTX(&multi_sensor_ctx);
+#if CONFIG_SUBSYS_ZIGBEE_DEVICE_POLL_CONTROL
+    ZB_AF_SET_ENDPOINT_HANDLER(ENDPOINT, endpoint_handler);
+    zigbee_poll_joining();
+#endif
+    clusters_attr_init();
+
+    zigbee_enable();
+    LOG_INF("Zigbee device started on endpoint %d", ENDPOINT);
+}
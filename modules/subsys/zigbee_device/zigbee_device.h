@@ -0,0 +1,11 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+// Register the sensor endpoint and start the Zigbee stack
+void start_zigbee_device(void);
+
+// Sensor bus handler. Hands the channels of record to the Zigbee thread,
+// which sets their measured values together with those of the records
+// arriving until it runs. Never blocks.
+void zigbee_device_publish_record(const struct sensor_bus_record *record);
@@ -0,0 +1,172 @@
+#include "zigbee_poll.h"
+
+#include <zephyr.h>
+#include <logging/log.h>
+#include <zboss_api.h>
+#if CONFIG_SHELL
+#include <shell/shell.h>
+#endif
+
+LOG_MODULE_DECLARE(zigbee_device);
+
+// Set once the stack starts, no polling before
+static bool started;
+static enum zigbee_poll_mode mode;
+static int64_t mode_since;
+// Time spent in each mode before the current stretch
+static int64_t mode_time_ms[ZIGBEE_POLL_MODE_COUNT];
+static uint32_t mode_entries[ZIGBEE_POLL_MODE_COUNT];
+// End of the fast polling, INT64_MAX while joining
+static int64_t fast_until;
+// Uptime the next report leaves at, INT64_MAX if none is scheduled
+static int64_t next_report = INT64_MAX;
+
+static void set_mode(enum zigbee_poll_mode next)
+{
+    int64_t now = k_uptime_get();
+
+    if (started)
+    {
+        mode_time_ms[mode] += now - mode_since;
+    }
+
+    mode_since = now;
+    if (!started || next != mode)
+    {
+        started = true;
+        LOG_DBG("%s polling", next == ZIGBEE_POLL_FAST ? "Fast" : "Long");
+        mode_entries[next]++;
+        mode = next;
+    }
+
+    // Setting the interval again also restarts the long polls from now
+    zb_zdo_pim_set_long_poll_interval(next == ZIGBEE_POLL_FAST ?
+                                      CONFIG_SUBSYS_ZIGBEE_DEVICE_FAST_POLL_MS :
+                                      CONFIG_SUBSYS_ZIGBEE_DEVICE_LONG_POLL_MS);
+}
+
+// param is set when the report is due now rather than whole long
+// intervals from now
+static void rearm_long(zb_uint8_t param)
+{
+    if (mode != ZIGBEE_POLL_LONG)
+    {
+        return;
+    }
+
+    set_mode(ZIGBEE_POLL_LONG);
+    if (param)
+    {
+        // Poll along with the report, the next long poll is one interval on
+        zb_zdo_pim_start_turbo_poll_packets(1);
+    }
+}
+
+// Restart the long polls a whole number of long intervals before the
+// next report, so that one of them falls on it
+static void align_long_polls(void)
+{
+    int64_t now = k_uptime_get();
+    int64_t ahead;
+
+    ZB_SCHEDULE_APP_ALARM_CANCEL(rearm_long, ZB_ALARM_ANY_PARAM);
+    if (mode != ZIGBEE_POLL_LONG || next_report == INT64_MAX ||
+        next_report < now)
+    {
+        return;
+    }
+
+    ahead = next_report - now;
+    ZB_SCHEDULE_APP_ALARM(rearm_long,
+                          ahead < CONFIG_SUBSYS_ZIGBEE_DEVICE_LONG_POLL_MS,
+                          ZB_MILLISECONDS_TO_BEACON_INTERVAL(
+                              ahead % CONFIG_SUBSYS_ZIGBEE_DEVICE_LONG_POLL_MS));
+}
+
+static void fast_expired(zb_uint8_t param)
+{
+    ARG_UNUSED(param);
+
+    set_mode(ZIGBEE_POLL_LONG);
+    align_long_polls();
+}
+
+void zigbee_poll_joining(void)
+{
+    fast_until = INT64_MAX;
+    ZB_SCHEDULE_APP_ALARM_CANCEL(fast_expired, ZB_ALARM_ANY_PARAM);
+    if (!started || mode != ZIGBEE_POLL_FAST)
+    {
+        set_mode(ZIGBEE_POLL_FAST);
+    }
+}
+
+void zigbee_poll_joined(void)
+{
+    // Ends the joining, even with no fast polling after it
+    fast_until = 0;
+    zigbee_poll_fast(CONFIG_SUBSYS_ZIGBEE_DEVICE_JOIN_FAST_POLL_MS);
+}
+
+void zigbee_poll_fast(uint32_t hold_ms)
+{
+    int64_t until = k_uptime_get() + hold_ms;
+
+    // Joining, or already fast for longer
+    if (until <= fast_until)
+    {
+        return;
+    }
+
+    fast_until = until;
+    if (mode != ZIGBEE_POLL_FAST)
+    {
+        set_mode(ZIGBEE_POLL_FAST);
+    }
+
+    ZB_SCHEDULE_APP_ALARM_CANCEL(fast_expired, ZB_ALARM_ANY_PARAM);
+    ZB_SCHEDULE_APP_ALARM(fast_expired, 0,
+                          ZB_MILLISECONDS_TO_BEACON_INTERVAL(hold_ms));
+}
+
+void zigbee_poll_report_at(int64_t at)
+{
+    next_report = at;
+    // Fast polling aligns once it expires
+    align_long_polls();
+}
+
+#if CONFIG_SHELL
+static int cmd_zigbee_poll_stats(const struct shell *shell, size_t argc,
+                                 char **argv)
+{
+    static const char *const names[] = {
+        [ZIGBEE_POLL_FAST] = "fast",
+        [ZIGBEE_POLL_LONG] = "long",
+    };
+    int64_t time_ms;
+
+    for (int i = 0; i < ZIGBEE_POLL_MODE_COUNT; i++)
+    {
+        time_ms = mode_time_ms[i];
+        if (started && i == mode)
+        {
+            time_ms += k_uptime_get() - mode_since;
+        }
+
+        shell_print(shell, "%s%s: %u s, entered %u times", names[i],
+                    started && i == mode ? " (current)" : "",
+                    (uint32_t)(time_ms / MSEC_PER_SEC), mode_entries[i]);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_zigbee_poll,
+    SHELL_CMD(stats, NULL, "Time spent in each poll mode",
+              cmd_zigbee_poll_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(zigbee_poll, &sub_zigbee_poll, "Zigbee poll control",
+                   NULL);
+#endif
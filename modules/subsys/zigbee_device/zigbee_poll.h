@@ -0,0 +1,32 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+enum zigbee_poll_mode
+{
+    ZIGBEE_POLL_FAST,
+    ZIGBEE_POLL_LONG,
+    ZIGBEE_POLL_MODE_COUNT,
+};
+
+// Poll fast until the device has joined, at start and after leaving
+void zigbee_poll_joining(void);
+
+// Joined or rejoined. Keeps polling fast while the coordinator
+// interviews the device, then polls long.
+void zigbee_poll_joined(void);
+
+/*
+ * Poll fast for at least hold_ms from now, while an exchange with the
+ * parent is going on. Long polls resume afterwards, lined up with the
+ * next report. Only to be called from the Zigbee thread.
+ */
+void zigbee_poll_fast(uint32_t hold_ms);
+
+/*
+ * The next report leaves at uptime at, or INT64_MAX if none is
+ * scheduled. While polling long, the long polls are restarted so that
+ * one of them falls on the report and the radio wakes up once for both.
+ * Only to be called from the Zigbee thread.
+ */
+void zigbee_poll_report_at(int64_t at);
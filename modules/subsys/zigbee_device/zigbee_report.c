@@ -0,0 +1,198 @@
+#include "zigbee_report.h"
+
+#include <zephyr.h>
+#include <logging/log.h>
+#include <stdlib.h>
+#if CONFIG_SHELL
+#include <shell/shell.h>
+#endif
+
+LOG_MODULE_DECLARE(zigbee_device);
+
+// Maximum interval of a configuration that turned reporting off
+#define MAX_INTERVAL_OFF 0xffff
+
+struct policy
+{
+    uint16_t min_interval_s;
+    uint16_t max_interval_s;
+    uint16_t change;
+};
+
+struct channel_state
+{
+    bool written;
+    int32_t value;
+    int64_t time;
+    // Of the last check, times the next periodic report
+    uint16_t max_interval_s;
+
+    uint32_t writes;
+    uint32_t skips;
+    uint32_t defers;
+};
+
+static const struct policy defaults[SENSOR_BUS_CHANNEL_COUNT] = {
+    [SENSOR_BUS_TEMPERATURE] = {
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_TEMPERATURE_MIN_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_TEMPERATURE_MAX_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_TEMPERATURE_CHANGE,
+    },
+    [SENSOR_BUS_HUMIDITY] = {
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_HUMIDITY_MIN_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_HUMIDITY_MAX_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_HUMIDITY_CHANGE,
+    },
+    [SENSOR_BUS_PRESSURE] = {
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_PRESSURE_MIN_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_PRESSURE_MAX_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_PRESSURE_CHANGE,
+    },
+    [SENSOR_BUS_LUMINOSITY] = {
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_LUMINOSITY_MIN_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_LUMINOSITY_MAX_INTERVAL,
+        CONFIG_SUBSYS_ZIGBEE_DEVICE_LUMINOSITY_CHANGE,
+    },
+};
+
+static struct channel_state states[SENSOR_BUS_CHANNEL_COUNT];
+
+void zigbee_report_defaults(enum sensor_bus_channel channel,
+                            zb_zcl_reporting_info_t *info)
+{
+    const struct policy *policy = &defaults[channel];
+
+    info->u.send_info.min_interval = policy->min_interval_s;
+    info->u.send_info.max_interval = policy->max_interval_s;
+    info->u.send_info.def_min_interval = policy->min_interval_s;
+    info->u.send_info.def_max_interval = policy->max_interval_s;
+    // Reportable changes are positive, the unsigned view fits all types
+    info->u.send_info.delta.u16 = policy->change;
+}
+
+// The configuration of the coordinator if there is one, with the
+// minimum interval raised to the floor
+static struct policy effective_policy(enum sensor_bus_channel channel,
+                                      const zb_zcl_reporting_info_t *info)
+{
+    struct policy policy;
+
+    if (info == NULL)
+    {
+        return defaults[channel];
+    }
+
+    policy.min_interval_s = MAX(info->u.send_info.min_interval,
+                                CONFIG_SUBSYS_ZIGBEE_DEVICE_REPORT_MIN_INTERVAL_FLOOR);
+    policy.max_interval_s = info->u.send_info.max_interval;
+    policy.change = info->u.send_info.delta.u16;
+
+    return policy;
+}
+
+enum zigbee_report_action zigbee_report_check(enum sensor_bus_channel channel,
+                                              const zb_zcl_reporting_info_t *info,
+                                              int32_t value, int64_t now,
+                                              uint32_t *defer_ms)
+{
+    struct channel_state *state = &states[channel];
+    struct policy policy = effective_policy(channel, info);
+    int64_t elapsed_ms = now - state->time;
+    int64_t min_ms = (int64_t)policy.min_interval_s * MSEC_PER_SEC;
+
+    state->max_interval_s = policy.max_interval_s;
+
+    // Nothing is sent for the attribute, keep it current for reads
+    if (!state->written || policy.max_interval_s == MAX_INTERVAL_OFF)
+    {
+        return ZIGBEE_REPORT_WRITE;
+    }
+
+    // The periodic report carries the attribute, so refresh it with the
+    // latest value even within the reportable change
+    if (policy.max_interval_s != 0 &&
+        elapsed_ms >= (int64_t)policy.max_interval_s * MSEC_PER_SEC)
+    {
+        return ZIGBEE_REPORT_WRITE;
+    }
+
+    if (abs(value - state->value) < MAX(policy.change, 1))
+    {
+        state->skips++;
+        return ZIGBEE_REPORT_SKIP;
+    }
+
+    if (elapsed_ms < min_ms)
+    {
+        state->defers++;
+        *defer_ms = min_ms - elapsed_ms;
+        return ZIGBEE_REPORT_DEFER;
+    }
+
+    return ZIGBEE_REPORT_WRITE;
+}
+
+void zigbee_report_written(enum sensor_bus_channel channel, int32_t value,
+                           int64_t now)
+{
+    struct channel_state *state = &states[channel];
+
+    state->written = true;
+    state->value = value;
+    state->time = now;
+    state->writes++;
+}
+
+int64_t zigbee_report_next(void)
+{
+    struct channel_state *state;
+    int64_t next = INT64_MAX;
+
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        state = &states[i];
+        if (!state->written || state->max_interval_s == 0 ||
+            state->max_interval_s == MAX_INTERVAL_OFF)
+        {
+            continue;
+        }
+
+        next = MIN(next, state->time +
+                             (int64_t)state->max_interval_s * MSEC_PER_SEC);
+    }
+
+    return next;
+}
+
+#if CONFIG_SHELL
+static const char *const channel_names[] = {
+    [SENSOR_BUS_TEMPERATURE] = "temperature",
+    [SENSOR_BUS_HUMIDITY] = "humidity",
+    [SENSOR_BUS_PRESSURE] = "pressure",
+    [SENSOR_BUS_LUMINOSITY] = "illuminance",
+};
+
+static int cmd_zigbee_report_stats(const struct shell *shell, size_t argc,
+                                   char **argv)
+{
+    struct channel_state *state;
+
+    for (int i = 0; i < SENSOR_BUS_CHANNEL_COUNT; i++)
+    {
+        state = &states[i];
+        shell_print(shell, "%s: written %u, skipped %u, deferred %u",
+                    channel_names[i], state->writes, state->skips,
+                    state->defers);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_zigbee_report,
+    SHELL_CMD(stats, NULL, "Measured value updates per channel",
+              cmd_zigbee_report_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(zigbee_report, &sub_zigbee_report,
+                   "Zigbee reporting policy", NULL);
+#endif
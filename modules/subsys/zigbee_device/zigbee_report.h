@@ -0,0 +1,39 @@
+#pragma once
+
+#include "sensor_bus.h"
+
+#include <zboss_api.h>
+
+enum zigbee_report_action
+{
+    // Set the attribute now
+    ZIGBEE_REPORT_WRITE,
+    // Changed enough, but the minimum interval has not passed yet
+    ZIGBEE_REPORT_DEFER,
+    // Within the reportable change, drop the value
+    ZIGBEE_REPORT_SKIP,
+};
+
+// Fill the minimum and maximum interval and the reportable change of a
+// reporting configuration with the Kconfig defaults of channel
+void zigbee_report_defaults(enum sensor_bus_channel channel,
+                            zb_zcl_reporting_info_t *info);
+
+/*
+ * Decide what to do with a new ZCL value of channel at uptime now, under
+ * the reporting configuration info of its attribute, or the defaults if
+ * info is NULL. With ZIGBEE_REPORT_DEFER, *defer_ms is the time until the
+ * value may be set. Only to be called from the Zigbee thread.
+ */
+enum zigbee_report_action zigbee_report_check(enum sensor_bus_channel channel,
+                                              const zb_zcl_reporting_info_t *info,
+                                              int32_t value, int64_t now,
+                                              uint32_t *defer_ms);
+
+// Note that value was set as the attribute of channel at uptime now
+void zigbee_report_written(enum sensor_bus_channel channel, int32_t value,
+                           int64_t now);
+
+// Uptime the next periodic report of a written channel is due at, or
+// INT64_MAX if none is
+int64_t zigbee_report_next(void);
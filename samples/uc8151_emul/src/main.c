@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 PHYTEC Messtechnik GmbH
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/display.h>
+#include <sys/crc.h>
+#include <sys/printk.h>
+
+#include "uc8151.h"
+
+#define DISPLAY_NODE		DT_CHOSEN(zephyr_display)
+#define PANEL_WIDTH		DT_PROP(DISPLAY_NODE, width)
+#define PANEL_HEIGHT		DT_PROP(DISPLAY_NODE, height)
+#define PANEL_PITCH		(PANEL_WIDTH / 8U)
+#define PANEL_SIZE		(PANEL_PITCH * PANEL_HEIGHT)
+
+static void print_result(enum uc8151_bench_step step,
+			 const struct uc8151_bench_result *result)
+{
+	const struct uc8151_stats *stats = &result->stats;
+	const struct uc8151_emul_stats *emul = &result->emul;
+
+	printk("%s: %u ms\n", uc8151_bench_name(step), result->time_ms);
+	printk("  driver: commands %u, payload %u B, transfers %u, "
+	       "dc toggles %u, busy waits %u (%u ms), refreshes %u, "
+	       "resets %u\n", stats->commands, stats->payload_bytes,
+	       stats->transfers, stats->dc_toggles, stats->busy_waits,
+	       stats->busy_wait_ms, stats->refreshes, stats->resets);
+	printk("  controller: commands %u, payload %u B, transfers %u, "
+	       "dc toggles %u, busy %u (%u ms), refreshes %u full "
+	       "%u partial, resets %u, errors %u\n", emul->commands,
+	       emul->payload_bytes, emul->transfers, emul->dc_toggles,
+	       emul->busy_periods, emul->busy_ms, emul->full_refreshes,
+	       emul->partial_refreshes, emul->resets, emul->errors);
+}
+
+static void print_panel(const uint8_t *panel)
+{
+	char line[PANEL_WIDTH + 1];
+
+	for (uint16_t y = 0; y < PANEL_HEIGHT; y++) {
+		for (uint16_t x = 0; x < PANEL_WIDTH; x++) {
+			line[x] = (panel[y * PANEL_PITCH + x / 8U] &
+				   BIT(7U - x % 8U)) ? '.' : '#';
+		}
+
+		line[PANEL_WIDTH] = '\0';
+		printk("%3u %s\n", y, line);
+	}
+
+	printk("crc32 0x%08x\n", crc32_ieee(panel, PANEL_SIZE));
+}
+
+void main(void)
+{
+	const struct device *dev = DEVICE_DT_GET(DISPLAY_NODE);
+	struct uc8151_bench_result result;
+	struct uc8151_emul_stats emul;
+	uint32_t errors = 0;
+	const uint8_t *panel;
+	int err;
+
+	if (!device_is_ready(dev)) {
+		printk("Display %s not ready\n", dev->name);
+		return;
+	}
+
+	err = display_blanking_off(dev);
+	if (!err) {
+		err = uc8151_wait_idle(dev);
+	}
+
+	if (err) {
+		printk("Blanking off failed: %d\n", err);
+		return;
+	}
+
+	/* Errors since the driver init, before the benchmark resets them */
+	uc8151_emul_get_stats(&emul);
+	errors += emul.errors;
+
+	for (int i = 0; i < UC8151_BENCH_STEP_COUNT; i++) {
+		err = uc8151_bench_run(dev, i, &result);
+		if (err) {
+			printk("%s failed: %d\n", uc8151_bench_name(i), err);
+			return;
+		}
+
+		print_result(i, &result);
+		errors += result.emul.errors;
+	}
+
+	panel = uc8151_emul_get_panel();
+	print_panel(panel);
+
+	if (memcmp(panel, display_get_framebuffer(dev), PANEL_SIZE)) {
+		printk("Panel differs from the framebuffer\n");
+	} else {
+		printk("Panel matches the framebuffer\n");
+	}
+
+	printk("Protocol errors %u\n", errors);
+}
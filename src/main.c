@@ -3,57 +3,51 @@
 #include <logging/log.h>
 #include <dk_buttons_and_leds.h>
 #include <drivers/sensor.h>
+#include <stdlib.h>
 
 #if CONFIG_SUBSYS_ZIGBEE_DEVICE
 #include "zigbee_device.h"
 #endif
 
-#if CONFIG_SUBSYS_BME280
-#include "bme280.h"
+#if CONFIG_SUBSYS_SENSOR_BUS
+#include "sensor_bus.h"
 #endif
 
-#if CONFIG_SUBSYS_MAX44009
-#include "max44009.h"
+#if CONFIG_SUBSYS_EINK_UI
+#include "eink_ui.h"
 #endif
 
 
 LOG_MODULE_REGISTER(main);
 
-#if CONFIG_SUBSYS_BME280
-static void handle_temperature_value(struct sensor_value value)
+#if CONFIG_SUBSYS_SENSOR_BUS
+static void log_channel(const struct sensor_bus_record *record,
+                        enum sensor_bus_channel channel, const char *name)
 {
-    LOG_INF("Temperature: %d.%06d Celsius", value.val1, value.val2);
-    if (value.val2 < 0)
-    {
-        LOG_WRN("Temperature failed.");
-    }
-}
-static void handle_humidity_value(struct sensor_value value)
-{
-    LOG_INF("Humidity: %d.%06d %%", value.val1, value.val2);
-    if (value.val2 < 0)
+    int32_t value = record->values[channel];
+
+    if (!sensor_bus_record_has(record, channel))
     {
-        LOG_WRN("Humidity failed.");
+        return;
     }
-}
-static void handle_pressure_value(struct sensor_value value)
-{
-    LOG_INF("Pressure: %1d.%06d hPa", value.val1, value.val2);
-    if (value.val2 < 0)
+
+    if (!sensor_bus_record_valid(record, channel))
     {
-        LOG_WRN("Pressure failed.");
+        LOG_WRN("%s failed (status: %u).", name, record->status[channel]);
+        return;
     }
+
+    LOG_INF("%s: %s%d.%02d", name, value < 0 ? "-" : "",
+            abs(value) / 100, abs(value) % 100);
 }
-#endif
 
-#if CONFIG_SUBSYS_MAX44009
-static void handle_luminosity_value(struct sensor_value value)
+static void handle_record(const struct sensor_bus_record *record)
 {
-    LOG_INF("LUX: %d.%06d", value.val1, value.val2);
-    if (value.val2 < 0)
-    {
-        LOG_WRN("Get LUX failed.");
-    }
+    LOG_INF("Sample at %lld ms", record->timestamp);
+    log_channel(record, SENSOR_BUS_TEMPERATURE, "Temperature (Celsius)");
+    log_channel(record, SENSOR_BUS_HUMIDITY, "Humidity (%)");
+    log_channel(record, SENSOR_BUS_PRESSURE, "Pressure (hPa)");
+    log_channel(record, SENSOR_BUS_LUMINOSITY, "LUX");
 }
 #endif
 
@@ -72,25 +66,25 @@ void main(void)
     start_zigbee_device();
 #endif
 
-#if CONFIG_SUBSYS_BME280
-    // Register sensor value handlers
-    bme280_register_temperature_handler(handle_temperature_value);
-    bme280_register_humidity_handler(handle_humidity_value);
-    bme280_register_pressure_handler(handle_pressure_value);
-#if CONFIG_SUBSYS_ZIGBEE_DEVICE
-    // Forward bme280 measurements to zigbee
-    bme280_register_temperature_handler(publish_temperature);
-    bme280_register_humidity_handler(publish_humidity);
-    bme280_register_pressure_handler(publish_pressure);
-#endif
+#if CONFIG_SUBSYS_EINK_UI
+    // Draw the dashboard
+    err = eink_ui_init();
+    if (err)
+    {
+        LOG_ERR("Cannot init display (err: %d)", err);
+    }
 #endif
 
-#if CONFIG_SUBSYS_MAX44009
-    // Register sensor value handlers
-    max44009_register_luminosity_handler(handle_luminosity_value);
+#if CONFIG_SUBSYS_SENSOR_BUS
+    // Register sensor record handlers
+    sensor_bus_subscribe(SENSOR_BUS_ALL_CHANNELS, handle_record, NULL);
 #if CONFIG_SUBSYS_ZIGBEE_DEVICE
     // Forward measurements to zigbee
-    max44009_register_luminosity_handler(publish_luminosity_value);
+    sensor_bus_subscribe(SENSOR_BUS_ALL_CHANNELS, zigbee_device_publish_record, NULL);
+#endif
+#if CONFIG_SUBSYS_EINK_UI
+    // Show measurements on the display
+    sensor_bus_subscribe(SENSOR_BUS_ALL_CHANNELS, eink_ui_show_record, NULL);
 #endif
 #endif
     while (1)